@@ -1,9 +1,25 @@
+#include <errno.h>
 #include <gmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
+#include <sys/random.h>
+
+#include "gmparena.h"
+#include "multiexp.h"
+#include "primality.h"
+#include "sha256.h"
+#include "stats.h"
+
+// Probable-prime test used by every prime search in this file:
+// PRIME_TEST_DEFAULT (mpz_nextprime) or PRIME_TEST_BPSW (Baillie-PSW).
+// Override at build time, e.g. -DRSA_PRIME_TEST=PRIME_TEST_BPSW
+#ifndef RSA_PRIME_TEST
+#define RSA_PRIME_TEST PRIME_TEST_DEFAULT
+#endif
 
 // Function to measure clock cycles
 unsigned long long get_clock_cycles() {
@@ -12,14 +28,33 @@ unsigned long long get_clock_cycles() {
     return ((unsigned long long)hi << 32) | lo;
 }
 
+// Move p to the next probable prime using the configured test
+static void next_prime(mpz_t p) {
+    if (RSA_PRIME_TEST == PRIME_TEST_BPSW) bpsw_nextprime(p, p);
+    else mpz_nextprime(p, p);
+}
+
+// Fill p with len bytes from the kernel CSPRNG. Returns 0, or -1 on failure.
+static int random_bytes(unsigned char *p, size_t len) {
+    while (len > 0) {
+        ssize_t got = getrandom(p, len, 0);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += got;
+        len -= (size_t)got;
+    }
+    return 0;
+}
+
 // Function to perform RSA operations for a given bit size
 void rsa_operations(int bit_size, FILE *output_file) {
     gmp_randstate_t state;
     mpz_t p, q, N, phi_N, e, d, m, c, m_prime, middle;
     unsigned long long start_cycles, end_cycles;
-    unsigned long long prime_gen_cycles[10000];
-    unsigned long long min_cycles = ULLONG_MAX, max_cycles = 0, sum_cycles = 0;
-    double avg_cycles;
+    qstat prime_gen_cycles;
+    qstat_init(&prime_gen_cycles);
 
     // Initialize GMP variables
     gmp_randinit_default(state);
@@ -38,7 +73,7 @@ void rsa_operations(int bit_size, FILE *output_file) {
         mpz_urandomb(middle, state, bit_size - 2);
         mpz_mul_2exp(middle, middle, 1);
         mpz_add(p, p, middle);
-        mpz_nextprime(p, p);
+        next_prime(p);
 
         // Generate q with MSB=1, LSB=1, middle bits random
         mpz_set_ui(q, 0);
@@ -47,20 +82,23 @@ void rsa_operations(int bit_size, FILE *output_file) {
         mpz_urandomb(middle, state, bit_size - 2);
         mpz_mul_2exp(middle, middle, 1);
         mpz_add(q, q, middle);
-        mpz_nextprime(q, q);
+        next_prime(q);
 
         end_cycles = get_clock_cycles();
         
-        prime_gen_cycles[i] = end_cycles - start_cycles;
-        sum_cycles += prime_gen_cycles[i];
-        if (prime_gen_cycles[i] < min_cycles) min_cycles = prime_gen_cycles[i];
-        if (prime_gen_cycles[i] > max_cycles) max_cycles = prime_gen_cycles[i];
+        qstat_add(&prime_gen_cycles, end_cycles - start_cycles);
     }
     
-    avg_cycles = (double)sum_cycles / 10000;
-    fprintf(output_file, "Minimum clock cycles: %llu\n", min_cycles);
-    fprintf(output_file, "Maximum clock cycles: %llu\n", max_cycles);
-    fprintf(output_file, "Average clock cycles: %.2f\n", avg_cycles);
+    fprintf(output_file, "Minimum clock cycles: %llu\n", (unsigned long long)prime_gen_cycles.min);
+    fprintf(output_file, "Maximum clock cycles: %llu\n", (unsigned long long)prime_gen_cycles.max);
+    fprintf(output_file, "Average clock cycles: %.2f\n", qstat_mean(&prime_gen_cycles));
+    // Past QSTAT_EXACT samples these are within 0.8% (see stats.h)
+    fprintf(output_file, "p50 / p90 / p99 / p99.9 clock cycles: %llu / %llu / %llu / %llu\n",
+            (unsigned long long)qstat_quantile(&prime_gen_cycles, 0.50),
+            (unsigned long long)qstat_quantile(&prime_gen_cycles, 0.90),
+            (unsigned long long)qstat_quantile(&prime_gen_cycles, 0.99),
+            (unsigned long long)qstat_quantile(&prime_gen_cycles, 0.999));
+    qstat_clear(&prime_gen_cycles);
 
     // Step 2: Compute RSA Modulus and Euler's Totient
     start_cycles = get_clock_cycles();
@@ -135,7 +173,769 @@ void rsa_operations(int bit_size, FILE *output_file) {
     gmp_randclear(state);
 }
 
+// ---------------------------------------------------------------------------
+// Multi-prime RSA (RFC 8017, Section 3): N = r_1 * r_2 * ... * r_k
+// ---------------------------------------------------------------------------
+
+#define RSA_MAX_PRIMES 4
+#define RSA_MAX_BYTES 512               // moduli up to 4096 bits
+#define MP_KEYGEN_RUNS 10
+#define MP_PRIVOP_RUNS 200
+
+typedef struct {
+    int k;                              // number of prime factors (2..RSA_MAX_PRIMES)
+    mpz_t n, e, d;
+    mpz_t r[RSA_MAX_PRIMES];            // prime factors r_i
+    mpz_t d_i[RSA_MAX_PRIMES];          // CRT exponents d mod (r_i - 1)
+    mpz_t R[RSA_MAX_PRIMES];            // prefix products R_i = r_1 * ... * r_{i-1}
+    mpz_t t[RSA_MAX_PRIMES];            // CRT coefficients t_i = R_i^-1 mod r_i
+} rsa_mp_key;
+
+void rsa_mp_key_init(rsa_mp_key *key) {
+    key->k = 0;
+    mpz_inits(key->n, key->e, key->d, NULL);
+    for (int i = 0; i < RSA_MAX_PRIMES; i++) {
+        mpz_inits(key->r[i], key->d_i[i], key->R[i], key->t[i], NULL);
+    }
+}
+
+void rsa_mp_key_clear(rsa_mp_key *key) {
+    mpz_clears(key->n, key->e, key->d, NULL);
+    for (int i = 0; i < RSA_MAX_PRIMES; i++) {
+        mpz_clears(key->r[i], key->d_i[i], key->R[i], key->t[i], NULL);
+    }
+}
+
+// Generate a prime with MSB=1, LSB=1 and exactly 'bits' bits.
+static void random_prime_exact(mpz_t r, int bits, gmp_randstate_t state) {
+    do {
+        mpz_urandomb(r, state, bits);
+        mpz_setbit(r, bits - 1);
+        mpz_setbit(r, 0);
+        next_prime(r);
+    } while (mpz_sizeinbase(r, 2) != (size_t)bits);
+}
+
+// Generate the last prime r so that R * r has exactly 'modulus_bits' bits:
+// r in [ceil(2^(modulus_bits-1) / R), floor((2^modulus_bits - 1) / R)].
+static void random_prime_cofactor(mpz_t r, const mpz_t R, int modulus_bits, gmp_randstate_t state) {
+    mpz_t lo, hi, span;
+    mpz_inits(lo, hi, span, NULL);
+
+    mpz_setbit(lo, modulus_bits - 1);
+    mpz_cdiv_q(lo, lo, R);
+    mpz_setbit(hi, modulus_bits);
+    mpz_sub_ui(hi, hi, 1);
+    mpz_fdiv_q(hi, hi, R);
+    mpz_sub(span, hi, lo);
+
+    do {
+        mpz_urandomm(r, state, span);
+        mpz_add(r, r, lo);
+        mpz_setbit(r, 0);
+        next_prime(r);
+    } while (mpz_cmp(r, hi) > 0);
+
+    mpz_clears(lo, hi, span, NULL);
+}
+
+// Generate a k-prime key with a modulus of exactly 'modulus_bits' bits and
+// e = 65537. The first k-1 primes have modulus_bits/k bits; the last one is
+// sized to complete the modulus. Returns 0 on success, -1 if k is unsupported.
+int rsa_mp_keygen(rsa_mp_key *key, int modulus_bits, int k, gmp_randstate_t state) {
+    if (k < 2 || k > RSA_MAX_PRIMES) return -1;
+    int prime_bits = modulus_bits / k;
+    mpz_t r_minus_1, g, lambda;
+    mpz_inits(r_minus_1, g, lambda, NULL);
+
+    key->k = k;
+    mpz_set_ui(key->e, 65537);
+    mpz_set_ui(lambda, 1);
+    mpz_set_ui(key->n, 1);
+
+    for (int i = 0; i < k; i++) {
+        int distinct;
+        do {
+            if (i < k - 1) {
+                random_prime_exact(key->r[i], prime_bits, state);
+            } else {
+                random_prime_cofactor(key->r[i], key->n, modulus_bits, state);
+            }
+            mpz_sub_ui(r_minus_1, key->r[i], 1);
+            mpz_gcd(g, key->e, r_minus_1);
+            distinct = 1;
+            for (int j = 0; j < i; j++) {
+                if (mpz_cmp(key->r[i], key->r[j]) == 0) distinct = 0;
+            }
+        } while (mpz_cmp_ui(g, 1) != 0 || !distinct);
+
+        mpz_lcm(lambda, lambda, r_minus_1);    // lambda(N) = lcm(r_i - 1)
+        mpz_set(key->R[i], key->n);            // R_i = product of earlier primes
+        mpz_mul(key->n, key->n, key->r[i]);
+    }
+
+    mpz_invert(key->d, key->e, lambda);        // d = e^-1 mod lambda(N)
+    for (int i = 0; i < k; i++) {
+        mpz_sub_ui(r_minus_1, key->r[i], 1);
+        mpz_mod(key->d_i[i], key->d, r_minus_1);
+        if (i > 0) mpz_invert(key->t[i], key->R[i], key->r[i]);
+    }
+
+    mpz_clears(r_minus_1, g, lambda, NULL);
+    return 0;
+}
+
+// Private operation (decryption and signing): k half-size exponentiations
+// m_i = c^d_i mod r_i, recombined with Garner's algorithm:
+//   m = m_1;  m += R_i * ((m_i - m) * t_i mod r_i)  for i = 2..k
+// The secret exponents only go through mpz_powm_sec, whose running time and
+// memory accesses do not depend on them. The input is blinded as well: the
+// exponentiations see c * b^e for a fresh random b, and the result is
+// multiplied by b^-1, so timing cannot be correlated with a chosen c.
+// m may alias c. Returns 0, or -1 if no random blinding factor was had.
+int rsa_mp_private(mpz_t m, const mpz_t c, const rsa_mp_key *key) {
+    size_t bytes = (mpz_sizeinbase(key->n, 2) + 7) / 8;
+    unsigned char rnd[RSA_MAX_BYTES + 8];
+    mpz_t b, b_inv, cb, m_i, h;
+    mpz_inits(b, b_inv, cb, m_i, h, NULL);
+
+    int ret = -1;
+    if (bytes > RSA_MAX_BYTES) goto done;
+    do {        // b in [1, n) invertible mod n; 8 extra bytes make b mod n uniform
+        if (random_bytes(rnd, bytes + 8) != 0) goto done;
+        mpz_import(b, bytes + 8, 1, 1, 1, 0, rnd);
+        mpz_mod(b, b, key->n);
+    } while (mpz_sgn(b) == 0 || !mpz_invert(b_inv, b, key->n));
+    mpz_powm(cb, b, key->e, key->n);    // public exponent: no secret involved
+    mpz_mul(cb, cb, c);
+    mpz_mod(cb, cb, key->n);
+
+    mpz_powm_sec(m, cb, key->d_i[0], key->r[0]);
+    for (int i = 1; i < key->k; i++) {
+        mpz_powm_sec(m_i, cb, key->d_i[i], key->r[i]);
+        mpz_sub(h, m_i, m);
+        mpz_mul(h, h, key->t[i]);
+        mpz_mod(h, h, key->r[i]);
+        mpz_addmul(m, key->R[i], h);
+    }
+    mpz_mul(m, m, b_inv);
+    mpz_mod(m, m, key->n);
+    ret = 0;
+
+done:
+    explicit_bzero(rnd, sizeof(rnd));
+    mpz_clears(b, b_inv, cb, m_i, h, NULL);
+    return ret;
+}
+
+int rsa_mp_decrypt(mpz_t m, const mpz_t c, const rsa_mp_key *key) {
+    return rsa_mp_private(m, c, key);
+}
+
+int rsa_mp_sign(mpz_t s, const mpz_t msg, const rsa_mp_key *key) {
+    return rsa_mp_private(s, msg, key);
+}
+
+// Benchmark key generation and the private operation for 2-, 3- and 4-prime
+// keys of the same modulus size, against a plain c^d mod N baseline (also
+// with mpz_powm_sec, like the private operation).
+void rsa_multiprime_benchmark(int modulus_bits, FILE *output_file) {
+    gmp_randstate_t state;
+    rsa_mp_key key;
+    mpz_t m, c, m_prime;
+    unsigned long long start_cycles, end_cycles;
+
+    gmp_randinit_default(state);
+    gmp_randseed_ui(state, time(NULL));
+    rsa_mp_key_init(&key);
+    mpz_inits(m, c, m_prime, NULL);
+
+    fprintf(output_file, "\n=== Multi-prime RSA (%d-bit modulus) ===\n", modulus_bits);
+    fprintf(output_file, "%-7s %-22s %-22s %-22s %s\n", "Primes", "Avg keygen cycles",
+            "Avg private cycles", "Avg plain powm_sec", "Verification");
+
+    for (int k = 2; k <= RSA_MAX_PRIMES; k++) {
+        unsigned long long keygen_sum = 0, crt_sum = 0, plain_sum = 0;
+        int verify = 1;
+
+        for (int i = 0; i < MP_KEYGEN_RUNS; i++) {
+            start_cycles = get_clock_cycles();
+            rsa_mp_keygen(&key, modulus_bits, k, state);
+            end_cycles = get_clock_cycles();
+            keygen_sum += end_cycles - start_cycles;
+        }
+
+        for (int i = 0; i < MP_PRIVOP_RUNS; i++) {
+            mpz_urandomm(m, state, key.n);
+            mpz_powm(c, m, key.e, key.n);
+
+            start_cycles = get_clock_cycles();
+            rsa_mp_decrypt(m_prime, c, &key);
+            end_cycles = get_clock_cycles();
+            crt_sum += end_cycles - start_cycles;
+            if (mpz_cmp(m, m_prime) != 0) verify = 0;
+
+            start_cycles = get_clock_cycles();
+            mpz_powm_sec(m_prime, c, key.d, key.n);
+            end_cycles = get_clock_cycles();
+            plain_sum += end_cycles - start_cycles;
+        }
+
+        fprintf(output_file, "%-7d %-22.2f %-22.2f %-22.2f %s\n", k,
+                (double)keygen_sum / MP_KEYGEN_RUNS,
+                (double)crt_sum / MP_PRIVOP_RUNS,
+                (double)plain_sum / MP_PRIVOP_RUNS,
+                verify ? "Success" : "Failed");
+    }
+
+    mpz_clears(m, c, m_prime, NULL);
+    rsa_mp_key_clear(&key);
+    gmp_randclear(state);
+}
+
+// ---------------------------------------------------------------------------
+// Public-key operations specialized for e = 65537 = 2^16 + 1
+// ---------------------------------------------------------------------------
+
+#define PUB_BENCH_KEYS 200
+#define PUB_BENCH_SIGS 20000
+
+// Per-key precomputed context: n, R^2 mod n and -n^-1 mod 2^52 in the 52-bit
+// limbs of multiexp.h's IFMA kernel, R = 2^(52 * limbs) >= 4n, ready to be
+// copied into a lane of rsa_verify_65537_batch. Read-only once built, so a
+// context may be shared between threads.
+typedef struct {
+    mpz_t n;
+    int limbs;              // 52-bit limbs per number
+    uint64_t *np;           // n as limbs, least significant first
+    uint64_t *r2;           // R^2 mod n
+    uint64_t n0inv;         // -n^-1 mod 2^52
+} rsa_pub_ctx;
+
+void rsa_pub_ctx_init(rsa_pub_ctx *ctx, const mpz_t n) {
+    mpz_t r2;
+    int limbs = (int)((mpz_sizeinbase(n, 2) + 2 + 51) / 52);
+
+    mpz_init_set(ctx->n, n);
+    ctx->limbs = limbs;
+    ctx->np = malloc(2 * limbs * sizeof(uint64_t));
+    ctx->r2 = ctx->np + limbs;
+    mexp_to_radix(ctx->np, 1, n, 52, limbs);
+
+    // Newton iteration for n0^-1 mod 2^64: each step doubles the correct bits
+    uint64_t n0 = mpz_getlimbn(n, 0), inv = n0;
+    for (int i = 0; i < 6; i++) inv *= 2 - n0 * inv;
+    ctx->n0inv = (0 - inv) & ((1ULL << 52) - 1);
+
+    mpz_init(r2);
+    mpz_setbit(r2, 2 * 52 * (mp_bitcnt_t)limbs);
+    mpz_mod(r2, r2, n);
+    mexp_to_radix(ctx->r2, 1, r2, 52, limbs);
+    mpz_clear(r2);
+}
+
+void rsa_pub_ctx_clear(rsa_pub_ctx *ctx) {
+    mpz_clear(ctx->n);
+    free(ctx->np);
+}
+
+// c = m^65537 mod n. One input at a time goes through GMP: a chain of 16 mpn
+// Montgomery squarings measured no faster than mpz_powm's assembly, so the
+// specialization is the batch verifier below, which runs eight keys at once.
+void rsa_public_65537(mpz_t c, const mpz_t m, const rsa_pub_ctx *ctx) {
+    mpz_powm_ui(c, m, 65537, ctx->n);
+}
+
+// One IFMA pass over the in-range pairs idx[0..lanes-1], whose keys all have
+// 'limbs' limbs. Idle lanes repeat lane 0's key with signature 0. buf holds
+// (7 * limbs + 2) * MEXP_LANES words, 64-byte aligned.
+static int rsaVerifyPass(const mpz_t *sigs, const mpz_t *msgs, rsa_pub_ctx *const *keys,
+                         const int *idx, int lanes, int limbs, uint64_t *buf, mpz_t out,
+                         int *results) {
+    size_t stride = (size_t)limbs * MEXP_LANES;
+    uint64_t *nv = buf, *r2 = nv + stride, *unit = r2 + stride, *mm = unit + stride;
+    uint64_t *x = mm + stride, *t = x + stride;
+    uint64_t k0[MEXP_LANES];
+    int valid = 0;
+
+    for (int l = 0; l < MEXP_LANES; l++) {
+        const rsa_pub_ctx *key = keys[idx[l < lanes ? l : 0]];
+        k0[l] = key->n0inv;
+        for (int j = 0; j < limbs; j++) {
+            nv[j * MEXP_LANES + l] = key->np[j];
+            r2[j * MEXP_LANES + l] = key->r2[j];
+            unit[j * MEXP_LANES + l] = j == 0;
+            x[j * MEXP_LANES + l] = 0;
+        }
+        if (l < lanes) mexp_to_radix(x + l, MEXP_LANES, sigs[idx[l]], 52, limbs);
+    }
+
+    mexp_amm_ifma(mm, x, r2, nv, k0, limbs, t);          // mont(s) = s * R mod n
+    mexp_amm_ifma(x, mm, mm, nv, k0, limbs, t);
+    for (int i = 1; i < 16; i++) mexp_amm_ifma(x, x, x, nv, k0, limbs, t);
+    mexp_amm_ifma(x, x, mm, nv, k0, limbs, t);           // mont(s^(2^16 + 1))
+    mexp_amm_ifma(x, x, unit, nv, k0, limbs, t);         // leave Montgomery form: <= n
+
+    for (int l = 0; l < lanes; l++) {
+        const rsa_pub_ctx *key = keys[idx[l]];
+        mexp_from_radix(out, x + l, MEXP_LANES, 52, limbs);
+        if (mpz_cmp(out, key->n) >= 0) mpz_sub(out, out, key->n);
+        results[idx[l]] = mpz_cmp(out, msgs[idx[l]]) == 0;
+        valid += results[idx[l]];
+    }
+    return valid;
+}
+
+// Verify count (signature, key) pairs: results[j] = (sigs[j]^65537 mod n_j == msgs[j]).
+// With AVX-512 IFMA (multiexp.h's kernel, chosen by MEXP_IMPL) MEXP_LANES
+// pairs share one pass: every limb step of the 19 almost-Montgomery
+// multiplications advances all lanes, each under its own key. The keys of a
+// pass must have the same limb count; pairs are taken in order and a pass is
+// cut short when the size changes, so mixed-size batches run fastest grouped
+// by size. Without IFMA each pair goes through rsa_public_65537.
+// A signature outside [0, n_j) is invalid without being exponentiated: the
+// Montgomery form would otherwise reduce sig + n_j to sig and accept it.
+// Returns the number of valid signatures, or -1 if scratch could not be
+// allocated.
+int rsa_verify_65537_batch(const mpz_t *sigs, const mpz_t *msgs, rsa_pub_ctx *const *keys,
+                           int count, int *results) {
+    int valid = 0;
+    mpz_t out;
+
+    if (mexp_detect() != MEXP_IMPL_IFMA) {
+        mpz_init(out);
+        for (int j = 0; j < count; j++) {
+            results[j] = 0;
+            if (mpz_sgn(sigs[j]) < 0 || mpz_cmp(sigs[j], keys[j]->n) >= 0) continue;
+            rsa_public_65537(out, sigs[j], keys[j]);
+            results[j] = mpz_cmp(out, msgs[j]) == 0;
+            valid += results[j];
+        }
+        mpz_clear(out);
+        return valid;
+    }
+
+    int max_limbs = 0;
+    for (int j = 0; j < count; j++) {
+        if (keys[j]->limbs > max_limbs) max_limbs = keys[j]->limbs;
+    }
+    size_t words = (size_t)(7 * max_limbs + 2) * MEXP_LANES;
+    uint64_t *buf = aligned_alloc(64, (words * sizeof(uint64_t) + 63) / 64 * 64);
+    if (buf == NULL) return -1;
+    mpz_init(out);
+
+    int idx[MEXP_LANES], lanes = 0;
+    for (int j = 0; j < count; j++) {
+        results[j] = 0;
+        if (mpz_sgn(sigs[j]) < 0 || mpz_cmp(sigs[j], keys[j]->n) >= 0) continue;
+        if (lanes > 0 && keys[j]->limbs != keys[idx[0]]->limbs) {
+            valid += rsaVerifyPass(sigs, msgs, keys, idx, lanes, keys[idx[0]]->limbs, buf, out, results);
+            lanes = 0;
+        }
+        idx[lanes++] = j;
+        if (lanes == MEXP_LANES) {
+            valid += rsaVerifyPass(sigs, msgs, keys, idx, lanes, keys[idx[0]]->limbs, buf, out, results);
+            lanes = 0;
+        }
+    }
+    if (lanes > 0) valid += rsaVerifyPass(sigs, msgs, keys, idx, lanes, keys[idx[0]]->limbs, buf, out, results);
+
+    mpz_clear(out);
+    free(buf);
+    return valid;
+}
+
+// Compare generic mpz_powm against rsa_verify_65537_batch on PUB_BENCH_SIGS
+// signatures spread over PUB_BENCH_KEYS distinct keys. The public operation
+// never uses the factorization, so each modulus is a random odd number of
+// full length and each message its signature raised to e: a few hundred real
+// 4096-bit keys would take minutes to generate.
+void rsa_public_benchmark(int modulus_bits, FILE *output_file) {
+    gmp_randstate_t state;
+    rsa_pub_ctx *ctxs = malloc(PUB_BENCH_KEYS * sizeof(rsa_pub_ctx));
+    rsa_pub_ctx **sig_keys = malloc(PUB_BENCH_SIGS * sizeof(rsa_pub_ctx *));
+    mpz_t *msgs = malloc(PUB_BENCH_SIGS * sizeof(mpz_t));
+    mpz_t *sigs = malloc(PUB_BENCH_SIGS * sizeof(mpz_t));
+    int *results = malloc(PUB_BENCH_SIGS * sizeof(int));
+    mpz_t e, n, c;
+    unsigned long long start_cycles, end_cycles;
+
+    gmp_randinit_default(state);
+    gmp_randseed_ui(state, time(NULL));
+    mpz_init_set_ui(e, 65537);
+    mpz_inits(n, c, NULL);
+
+    for (int i = 0; i < PUB_BENCH_KEYS; i++) {
+        mpz_urandomb(n, state, modulus_bits);
+        mpz_setbit(n, modulus_bits - 1);
+        mpz_setbit(n, 0);
+        rsa_pub_ctx_init(&ctxs[i], n);
+    }
+    for (int j = 0; j < PUB_BENCH_SIGS; j++) {
+        sig_keys[j] = &ctxs[j % PUB_BENCH_KEYS];
+        mpz_init(msgs[j]);
+        mpz_init(sigs[j]);
+        mpz_urandomm(sigs[j], state, sig_keys[j]->n);
+        mpz_powm(msgs[j], sigs[j], e, sig_keys[j]->n);
+    }
+
+    int generic_ok = 0, batch_ok;
+
+    start_cycles = get_clock_cycles();
+    for (int j = 0; j < PUB_BENCH_SIGS; j++) {
+        mpz_powm(c, sigs[j], e, sig_keys[j]->n);
+        generic_ok += mpz_cmp(c, msgs[j]) == 0;
+    }
+    end_cycles = get_clock_cycles();
+    unsigned long long generic_cycles = end_cycles - start_cycles;
+
+    start_cycles = get_clock_cycles();
+    batch_ok = rsa_verify_65537_batch((const mpz_t *)sigs, (const mpz_t *)msgs, sig_keys,
+                                      PUB_BENCH_SIGS, results);
+    end_cycles = get_clock_cycles();
+    unsigned long long batch_cycles = end_cycles - start_cycles;
+
+    // sig + n is congruent to a valid signature and must still be rejected
+    mpz_add(c, sigs[0], sig_keys[0]->n);
+    int malleable = rsa_verify_65537_batch((const mpz_t *)&c, (const mpz_t *)msgs, sig_keys, 1, results);
+
+    fprintf(output_file, "\n=== Public-key verification, e = 65537 (%d-bit modulus, %d keys) ===\n",
+            modulus_bits, PUB_BENCH_KEYS);
+    fprintf(output_file, "Generic mpz_powm: %.2f cycles/verify (%d/%d valid)\n",
+            (double)generic_cycles / PUB_BENCH_SIGS, generic_ok, PUB_BENCH_SIGS);
+    fprintf(output_file, "Batch (%s): %.2f cycles/verify (%d/%d valid, sig + n %s)\n",
+            mexp_detect() == MEXP_IMPL_IFMA ? "avx512-ifma, 8 keys per pass" : "mpz_powm per pair",
+            (double)batch_cycles / PUB_BENCH_SIGS, batch_ok, PUB_BENCH_SIGS,
+            malleable == 0 ? "rejected" : "ACCEPTED");
+
+    for (int j = 0; j < PUB_BENCH_SIGS; j++) mpz_clears(msgs[j], sigs[j], NULL);
+    for (int i = 0; i < PUB_BENCH_KEYS; i++) rsa_pub_ctx_clear(&ctxs[i]);
+    free(ctxs); free(sig_keys); free(msgs); free(sigs); free(results);
+    mpz_clears(e, n, c, NULL);
+    gmp_randclear(state);
+}
+
+// ---------------------------------------------------------------------------
+// RSA-OAEP and RSA-PSS (RFC 8017, Sections 7.1 and 8.1) with SHA-256 and
+// MGF1-SHA-256. Private operations go through rsa_mp_private, public ones
+// through rsa_public_65537 (every key here has e = 65537).
+// ---------------------------------------------------------------------------
+
+#define RSA_HLEN SHA256_DIGEST
+#define RSA_PSS_SLEN RSA_HLEN          // salt length, as TLS 1.3 requires
+#define PAD_BENCH_OPS 200
+#define PAD_BENCH_MSGS 2000
+#define PAD_BENCH_MSG_BYTES 256
+#define PAD_BENCH_HASH_REPS 20
+
+// I2OSP: x as exactly len big-endian bytes. Returns -1 if x does not fit.
+static int i2osp(unsigned char *out, size_t len, const mpz_t x) {
+    size_t bytes = mpz_sgn(x) == 0 ? 0 : (mpz_sizeinbase(x, 2) + 7) / 8;
+    if (bytes > len) return -1;
+    memset(out, 0, len - bytes);
+    mpz_export(out + len - bytes, NULL, 1, 1, 1, 0, x);
+    return 0;
+}
+
+// OS2IP: len big-endian bytes as an integer
+static void os2ip(mpz_t x, const unsigned char *in, size_t len) {
+    mpz_import(x, len, 1, 1, 1, 0, in);
+}
+
+// out ^= MGF1-SHA-256(seed, out_len)
+static void mgf1_xor(unsigned char *out, size_t out_len, const unsigned char *seed, size_t seed_len) {
+    unsigned char in[RSA_MAX_BYTES + 4], mask[RSA_HLEN];
+    memcpy(in, seed, seed_len);
+    for (uint32_t counter = 0; out_len > 0; counter++) {
+        for (int i = 0; i < 4; i++) in[seed_len + i] = (unsigned char)(counter >> (24 - 8 * i));
+        sha256(in, seed_len + 4, mask);
+        size_t n = out_len < RSA_HLEN ? out_len : RSA_HLEN;
+        for (size_t i = 0; i < n; i++) out[i] ^= mask[i];
+        out += n;
+        out_len -= n;
+    }
+}
+
+// All ones if x == 0, else 0, without a branch on x
+static size_t ct_zero_mask(size_t x) {
+    return (size_t)0 - ((~x & (x - 1)) >> (8 * sizeof(size_t) - 1));
+}
+
+static size_t modulus_bytes(const mpz_t n) {
+    return (mpz_sizeinbase(n, 2) + 7) / 8;
+}
+
+// RSAES-OAEP-ENCRYPT: writes the k-byte ciphertext of msg (at most
+// k - 2*hLen - 2 bytes) under an optional label. Returns k, or -1 if the
+// message is too long.
+int rsa_oaep_encrypt(unsigned char *c, const unsigned char *msg, size_t msg_len,
+                     const unsigned char *label, size_t label_len, rsa_pub_ctx *pub) {
+    size_t k = modulus_bytes(pub->n);
+    if (k > RSA_MAX_BYTES || k < 2 * RSA_HLEN + 2 || msg_len > k - 2 * RSA_HLEN - 2) return -1;
+
+    // EM = 0x00 || maskedSeed || maskedDB,  DB = lHash || PS || 0x01 || M
+    unsigned char em[RSA_MAX_BYTES];
+    unsigned char *seed = em + 1, *db = em + 1 + RSA_HLEN;
+    size_t db_len = k - RSA_HLEN - 1;
+    em[0] = 0;
+    sha256(label, label_len, db);
+    memset(db + RSA_HLEN, 0, db_len - RSA_HLEN - msg_len - 1);
+    db[db_len - msg_len - 1] = 0x01;
+    memcpy(db + db_len - msg_len, msg, msg_len);
+    if (random_bytes(seed, RSA_HLEN) != 0) return -1;
+    mgf1_xor(db, db_len, seed, RSA_HLEN);
+    mgf1_xor(seed, RSA_HLEN, db, db_len);
+
+    mpz_t m;
+    mpz_init(m);
+    os2ip(m, em, k);
+    rsa_public_65537(m, m, pub);
+    i2osp(c, k, m);
+    mpz_clear(m);
+    return (int)k;
+}
+
+// RSAES-OAEP-DECRYPT. Returns the message length, or -1 for any invalid
+// ciphertext. The padding checks run over every byte and are combined
+// before the single branch on the result, so a caller that answers "bad
+// padding" and "bad label" alike gives an attacker nothing to tell apart
+// (Manger's attack); the blinded, fixed-time rsa_mp_private does the same for
+// the exponentiation before them.
+int rsa_oaep_decrypt(unsigned char *msg, size_t msg_cap, const unsigned char *c, size_t c_len,
+                     const unsigned char *label, size_t label_len, const rsa_mp_key *key) {
+    size_t k = modulus_bytes(key->n);
+    if (k > RSA_MAX_BYTES || k < 2 * RSA_HLEN + 2 || c_len != k) return -1;
+
+    mpz_t ci, m;
+    mpz_inits(ci, m, NULL);
+    os2ip(ci, c, k);
+    if (mpz_cmp(ci, key->n) >= 0) {
+        mpz_clears(ci, m, NULL);
+        return -1;
+    }
+    if (rsa_mp_private(m, ci, key) != 0) {
+        mpz_clears(ci, m, NULL);
+        return -1;
+    }
+
+    unsigned char em[RSA_MAX_BYTES], lhash[RSA_HLEN];
+    unsigned char *seed = em + 1, *db = em + 1 + RSA_HLEN;
+    size_t db_len = k - RSA_HLEN - 1;
+    i2osp(em, k, m);      // m < n always fits in k bytes
+    mpz_clears(ci, m, NULL);
+    mgf1_xor(seed, RSA_HLEN, db, db_len);
+    mgf1_xor(db, db_len, seed, RSA_HLEN);
+    sha256(label, label_len, lhash);
+
+    size_t bad = em[0];
+    for (size_t i = 0; i < RSA_HLEN; i++) bad |= db[i] ^ lhash[i];
+    // Find the 0x01 after the zero padding; anything else before it is bad
+    size_t looking = SIZE_MAX, sep = 0;
+    for (size_t i = RSA_HLEN; i < db_len; i++) {
+        size_t is0 = ct_zero_mask(db[i]), is1 = ct_zero_mask(db[i] ^ 1);
+        sep |= looking & is1 & i;
+        bad |= looking & ~is0 & ~is1;
+        looking &= ~is1;
+    }
+    bad |= looking;
+
+    int ret = -1;
+    if (bad == 0 && db_len - sep - 1 <= msg_cap) {
+        ret = (int)(db_len - sep - 1);
+        memcpy(msg, db + sep + 1, (size_t)ret);
+    }
+    explicit_bzero(em, sizeof(em));
+    return ret;
+}
+
+// RSASSA-PSS-SIGN of a SHA-256 message hash with a 32-byte salt. The hash
+// is taken separately so that a batch can be hashed with sha256_many.
+// Writes k bytes; returns k, or -1 if the modulus is too small, randomness
+// is short, or the signature fails its check against the public key.
+int rsa_pss_sign(unsigned char *sig, const unsigned char mhash[RSA_HLEN], const rsa_mp_key *key) {
+    size_t mod_bits = mpz_sizeinbase(key->n, 2), k = (mod_bits + 7) / 8;
+    size_t em_bits = mod_bits - 1, em_len = (em_bits + 7) / 8;
+    if (k > RSA_MAX_BYTES || em_len < RSA_HLEN + RSA_PSS_SLEN + 2) return -1;
+
+    // M' = 0x00 * 8 || mHash || salt;  H = Hash(M')
+    unsigned char mprime[8 + RSA_HLEN + RSA_PSS_SLEN], em[RSA_MAX_BYTES];
+    unsigned char *salt = mprime + 8 + RSA_HLEN;
+    memset(mprime, 0, 8);
+    memcpy(mprime + 8, mhash, RSA_HLEN);
+    if (random_bytes(salt, RSA_PSS_SLEN) != 0) return -1;
+
+    // EM = maskedDB || H || 0xbc,  DB = PS || 0x01 || salt
+    size_t db_len = em_len - RSA_HLEN - 1;
+    unsigned char *db = em, *h = em + db_len;
+    sha256(mprime, sizeof(mprime), h);
+    memset(db, 0, db_len - RSA_PSS_SLEN - 1);
+    db[db_len - RSA_PSS_SLEN - 1] = 0x01;
+    memcpy(db + db_len - RSA_PSS_SLEN, salt, RSA_PSS_SLEN);
+    mgf1_xor(db, db_len, h, RSA_HLEN);
+    db[0] &= 0xff >> (8 * em_len - em_bits);
+    em[em_len - 1] = 0xbc;
+
+    // A fault in one CRT half would give a signature s with s^e = EM mod one
+    // prime but not the other, and gcd(s^e - EM, n) would factor n (Bellcore):
+    // nothing leaves without being checked against the public key
+    mpz_t m, s, v;
+    mpz_inits(m, s, v, NULL);
+    os2ip(m, em, em_len);
+    int ret = -1;
+    if (rsa_mp_private(s, m, key) == 0) {
+        mpz_powm(v, s, key->e, key->n);
+        if (mpz_cmp(v, m) == 0) {
+            i2osp(sig, k, s);
+            ret = (int)k;
+        }
+    }
+    mpz_clears(m, s, v, NULL);
+    return ret;
+}
+
+// RSASSA-PSS-VERIFY with the parameters of rsa_pss_sign. Returns 1 if sig
+// is a valid signature of mhash, else 0.
+int rsa_pss_verify(const unsigned char *sig, size_t sig_len, const unsigned char mhash[RSA_HLEN],
+                   rsa_pub_ctx *pub) {
+    size_t mod_bits = mpz_sizeinbase(pub->n, 2), k = (mod_bits + 7) / 8;
+    size_t em_bits = mod_bits - 1, em_len = (em_bits + 7) / 8;
+    if (k > RSA_MAX_BYTES || sig_len != k || em_len < RSA_HLEN + RSA_PSS_SLEN + 2) return 0;
+
+    unsigned char em[RSA_MAX_BYTES];
+    mpz_t m;
+    mpz_init(m);
+    os2ip(m, sig, k);
+    int ok = mpz_cmp(m, pub->n) < 0;
+    if (ok) {
+        rsa_public_65537(m, m, pub);
+        ok = i2osp(em, em_len, m) == 0;
+    }
+    mpz_clear(m);
+    if (!ok || em[em_len - 1] != 0xbc) return 0;
+
+    size_t db_len = em_len - RSA_HLEN - 1;
+    unsigned char *db = em, *h = em + db_len;
+    unsigned char top = (unsigned char)(0xff >> (8 * em_len - em_bits));
+    if (db[0] & ~top) return 0;
+    mgf1_xor(db, db_len, h, RSA_HLEN);
+    db[0] &= top;
+    for (size_t i = 0; i < db_len - RSA_PSS_SLEN - 1; i++) {
+        if (db[i] != 0) return 0;
+    }
+    if (db[db_len - RSA_PSS_SLEN - 1] != 0x01) return 0;
+
+    unsigned char mprime[8 + RSA_HLEN + RSA_PSS_SLEN], h2[RSA_HLEN];
+    memset(mprime, 0, 8);
+    memcpy(mprime + 8, mhash, RSA_HLEN);
+    memcpy(mprime + 8 + RSA_HLEN, db + db_len - RSA_PSS_SLEN, RSA_PSS_SLEN);
+    sha256(mprime, sizeof(mprime), h2);
+    return memcmp(h, h2, RSA_HLEN) == 0;
+}
+
+// OAEP round trips, and a signing workload: PAD_BENCH_MSGS messages of
+// PAD_BENCH_MSG_BYTES bytes hashed one at a time and with sha256_many, the
+// first PAD_BENCH_OPS of them then PSS-signed and verified. Tampered ciphertexts, labels, signatures and
+// hashes must all be rejected.
+void rsa_padding_benchmark(int modulus_bits, FILE *output_file) {
+    gmp_randstate_t state;
+    rsa_mp_key key;
+    rsa_pub_ctx pub;
+    unsigned char c[RSA_MAX_BYTES], pt[RSA_MAX_BYTES], msg[RSA_HLEN];
+    static const unsigned char label[] = "rsa_padding_benchmark";
+    unsigned long long start_cycles, enc_sum = 0, dec_sum = 0;
+
+    gmp_randinit_default(state);
+    gmp_randseed_ui(state, time(NULL));
+    rsa_mp_key_init(&key);
+    rsa_mp_keygen(&key, modulus_bits, 2, state);
+    rsa_pub_ctx_init(&pub, key.n);
+
+    // OAEP: a 32-byte session key per round trip
+    int round_trips = 0, rejected = 0;
+    for (int i = 0; i < PAD_BENCH_OPS; i++) {
+        random_bytes(msg, sizeof(msg));
+        start_cycles = get_clock_cycles();
+        int c_len = rsa_oaep_encrypt(c, msg, sizeof(msg), label, sizeof(label) - 1, &pub);
+        enc_sum += get_clock_cycles() - start_cycles;
+        start_cycles = get_clock_cycles();
+        int pt_len = rsa_oaep_decrypt(pt, sizeof(pt), c, (size_t)c_len, label, sizeof(label) - 1, &key);
+        dec_sum += get_clock_cycles() - start_cycles;
+        round_trips += pt_len == (int)sizeof(msg) && memcmp(pt, msg, sizeof(msg)) == 0;
+
+        rejected += rsa_oaep_decrypt(pt, sizeof(pt), c, (size_t)c_len, label, sizeof(label) - 2, &key) < 0;
+        c[i % c_len] ^= 0x01;
+        rejected += rsa_oaep_decrypt(pt, sizeof(pt), c, (size_t)c_len, label, sizeof(label) - 1, &key) < 0;
+    }
+
+    fprintf(output_file, "\n=== RSA-OAEP / RSA-PSS with SHA-256 (%d-bit modulus) ===\n", modulus_bits);
+    fprintf(output_file, "OAEP encrypt: %.2f cycles, decrypt: %.2f cycles (%d/%d round trips, "
+            "%d/%d tampered rejected)\n", (double)enc_sum / PAD_BENCH_OPS, (double)dec_sum / PAD_BENCH_OPS,
+            round_trips, PAD_BENCH_OPS, rejected, 2 * PAD_BENCH_OPS);
+
+    // PSS over a batch of messages
+    unsigned char *data = malloc((size_t)PAD_BENCH_MSGS * PAD_BENCH_MSG_BYTES);
+    unsigned char (*one)[SHA256_DIGEST] = malloc(PAD_BENCH_MSGS * sizeof(*one));
+    unsigned char (*many)[SHA256_DIGEST] = malloc(PAD_BENCH_MSGS * sizeof(*many));
+    unsigned char *sigs = malloc((size_t)PAD_BENCH_MSGS * RSA_MAX_BYTES);
+    const unsigned char **msgs = malloc(PAD_BENCH_MSGS * sizeof(*msgs));
+    size_t *lens = malloc(PAD_BENCH_MSGS * sizeof(*lens));
+    random_bytes(data, (size_t)PAD_BENCH_MSGS * PAD_BENCH_MSG_BYTES);
+    for (int j = 0; j < PAD_BENCH_MSGS; j++) {
+        msgs[j] = data + (size_t)j * PAD_BENCH_MSG_BYTES;
+        lens[j] = PAD_BENCH_MSG_BYTES;
+    }
+
+    unsigned long long one_best = ULLONG_MAX, many_best = ULLONG_MAX;
+    for (int r = 0; r < PAD_BENCH_HASH_REPS; r++) {
+        start_cycles = get_clock_cycles();
+        for (int j = 0; j < PAD_BENCH_MSGS; j++) sha256(msgs[j], lens[j], one[j]);
+        unsigned long long t = get_clock_cycles() - start_cycles;
+        if (t < one_best) one_best = t;
+        start_cycles = get_clock_cycles();
+        sha256_many(PAD_BENCH_MSGS, msgs, lens, many);
+        t = get_clock_cycles() - start_cycles;
+        if (t < many_best) many_best = t;
+    }
+    int hashes_match = memcmp(one, many, PAD_BENCH_MSGS * sizeof(*one)) == 0;
+
+    int k = 0, signed_ok = 0, valid = 0, forged = 0;
+    start_cycles = get_clock_cycles();
+    for (int j = 0; j < PAD_BENCH_OPS; j++) {
+        k = rsa_pss_sign(sigs + (size_t)j * RSA_MAX_BYTES, many[j], &key);
+        signed_ok += k > 0;
+    }
+    unsigned long long sign_cycles = get_clock_cycles() - start_cycles;
+    start_cycles = get_clock_cycles();
+    for (int j = 0; j < PAD_BENCH_OPS; j++)
+        valid += rsa_pss_verify(sigs + (size_t)j * RSA_MAX_BYTES, (size_t)k, many[j], &pub);
+    unsigned long long verify_cycles = get_clock_cycles() - start_cycles;
+    for (int j = 0; j < PAD_BENCH_OPS; j++) {
+        unsigned char *sig = sigs + (size_t)j * RSA_MAX_BYTES;
+        forged += rsa_pss_verify(sig, (size_t)k, many[(j + 1) % PAD_BENCH_MSGS], &pub);
+        sig[j % k] ^= 0x80;
+        forged += rsa_pss_verify(sig, (size_t)k, many[j], &pub);
+    }
+
+    fprintf(output_file, "SHA-256 of %d x %d-byte messages: one at a time (%s) %.2f cycles/msg, "
+            "sha256_many (%s) %.2f cycles/msg (%s)\n", PAD_BENCH_MSGS, PAD_BENCH_MSG_BYTES,
+            sha256_impl()->impl.name, (double)one_best / PAD_BENCH_MSGS,
+            sha256_mb_impl()->impl.name, (double)many_best / PAD_BENCH_MSGS,
+            hashes_match ? "digests match" : "DIGESTS DIFFER");
+    fprintf(output_file, "PSS sign: %.2f cycles, verify: %.2f cycles (%d/%d signed, %d/%d valid, "
+            "%d/%d tampered accepted)\n", (double)sign_cycles / PAD_BENCH_OPS,
+            (double)verify_cycles / PAD_BENCH_OPS, signed_ok, PAD_BENCH_OPS, valid, PAD_BENCH_OPS,
+            forged, 2 * PAD_BENCH_OPS);
+
+    free(data); free(one); free(many); free(sigs); free(msgs); free(lens);
+    rsa_pub_ctx_clear(&pub);
+    rsa_mp_key_clear(&key);
+    gmp_randclear(state);
+}
+
 int main() {
+    // Key material lives in locked, zeroized GMP blocks (GMP_ARENA to change)
+    gmp_arena_install(GMP_ARENA_SECURE);
+
     FILE *output_file = fopen("rsa_results.txt", "w");
     if (!output_file) {
         printf("Error opening output file\n");
@@ -147,7 +947,21 @@ int main() {
     rsa_operations(768, output_file);
     rsa_operations(1024, output_file);
 
+    // Compare 2-, 3- and 4-prime keys for the same modulus size
+    rsa_multiprime_benchmark(2048, output_file);
+    rsa_multiprime_benchmark(3072, output_file);
+    rsa_multiprime_benchmark(4096, output_file);
+
+    // Batched e = 65537 signature verification against many keys
+    rsa_public_benchmark(2048, output_file);
+    rsa_public_benchmark(4096, output_file);
+
+    // OAEP encryption and PSS signatures, with batched message hashing
+    rsa_padding_benchmark(2048, output_file);
+
+    gmp_arena_report(output_file);
     fclose(output_file);
     printf("Results written to rsa_results.txt\n");
+    gmp_arena_release();
     return 0;
 }
@@ -15,6 +15,9 @@ bs_swaps = data['BubbleSortSwaps']
 hs_comp = data['HeapSortComp']
 hs_swaps = data['HeapSortSwaps']
 
+# sortbench.c sweeps sizes over several decades: use log axes there
+log_axes = sizes.max() > 100 * sizes.min()
+
 # -------- Plot Comparisons --------
 plt.figure(figsize=(10, 6))
 plt.plot(sizes, qs_comp, label='QuickSort', marker='o')
@@ -22,6 +25,9 @@ plt.plot(sizes, ms_comp, label='MergeSort', marker='s')
 plt.plot(sizes, bs_comp, label='BubbleSort', marker='^')
 plt.plot(sizes, hs_comp, label='HeapSort', marker='d')
 
+if log_axes:
+    plt.xscale('log')
+    plt.yscale('log')
 plt.xlabel('Array Size')
 plt.ylabel('Median Comparisons')
 plt.title('Median Comparisons vs Array Size')
@@ -42,6 +48,9 @@ plt.plot(sizes, ms_swaps, label='MergeSort', marker='s')
 plt.plot(sizes, bs_swaps, label='BubbleSort', marker='^')
 plt.plot(sizes, hs_swaps, label='HeapSort', marker='d')
 
+if log_axes:
+    plt.xscale('log')
+    plt.yscale('log')
 plt.xlabel('Array Size')
 plt.ylabel('Median Swaps')
 plt.title('Median Swaps vs Array Size')
@@ -55,3 +64,23 @@ plt.show()
 
 print(f"Saved swaps plot as: {swaps_img}")
 
+# -------- Plot Median Time (sortbench.c output only) --------
+if 'QuickSortSeconds' in data:
+    plt.figure(figsize=(10, 6))
+    for name, marker in [('QuickSort', 'o'), ('MergeSort', 's'), ('BubbleSort', '^'),
+                         ('HeapSort', 'd'), ('RadixSort', 'x'), ('SimdSort', 'v')]:
+        plt.plot(sizes, data[name + 'Seconds'], label=name, marker=marker)
+
+    if log_axes:
+        plt.xscale('log')
+        plt.yscale('log')
+    plt.xlabel('Array Size')
+    plt.ylabel('Median Seconds')
+    plt.title('Median Time vs Array Size')
+    plt.legend()
+    plt.grid(True)
+
+    time_img = "sorting_median_time.png"
+    plt.savefig(time_img, dpi=300)
+    plt.show()
+    print(f"Saved time plot as: {time_img}")
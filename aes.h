@@ -0,0 +1,375 @@
+// aes.h
+// AES-128 (FIPS-197), shared by AES.c and cipherbench.c.
+//   aes_encrypt_block, aes_decrypt_block - one block under a raw 16-byte key;
+//                                         the key is expanded on every call
+//   aes128_ctx                          - key schedule expanded once by
+//                                         aes128_init, plus a CTR counter block
+//   aes128_encrypt, aes128_decrypt      - one block under a key schedule
+//   aes128_ctr_start, aes128_ctr        - CTR mode (SP 800-38A): keystream block
+//                                         i is E(nonce || counter + i), the
+//                                         96-bit nonce and 32-bit big-endian
+//                                         counter laid out as in GCM
+// Encryption (block and CTR) runs on the kernel picked by cpudispatch.h:
+//   aesni  - AES-NI rounds; CTR keeps AES_NI_LANES blocks in flight to cover
+//            the latency of AESENC (AES_IMPL=aesni)
+//   scalar - byte-oriented rounds on a column-major state (state[r][c] =
+//            in[4c + r]) as in the standard. Its table lookups are indexed by
+//            key-dependent bytes, so its timing is not constant (AES_IMPL=scalar)
+// The kernel must pass the FIPS-197 and SP 800-38A F.5.1 vectors, and match
+// the scalar CTR keystream across its batch boundaries, before it is used.
+// Decryption is scalar only.
+
+#ifndef AES_H
+#define AES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "cpudispatch.h"
+
+#define AES_NI_LANES 8
+
+// S-box
+static const unsigned char aes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+// Inverse S-box
+static const unsigned char aes_inv_sbox[256] = {
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
+};
+
+// Rcon
+static const unsigned char aes_rcon[11] = {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
+
+// --- Round functions ---------------------------------------------------------
+
+// Multiplication by x in GF(2^8) mod x^8 + x^4 + x^3 + x + 1
+static inline unsigned char aes_xtime(unsigned char a) {
+    return (unsigned char)((a << 1) ^ ((a & 0x80) ? 0x1b : 0));
+}
+
+// GF(2^8) multiplication
+static inline unsigned char aes_gf_mul(unsigned char a, unsigned char b) {
+    unsigned char p = 0;
+    for (int counter = 0; counter < 8; counter++) {
+        if (b & 1) p ^= a;
+        a = aes_xtime(a);
+        b >>= 1;
+    }
+    return p;
+}
+
+// Key expansion: 11 round keys of 16 bytes
+static inline void aes_expand_key(const unsigned char *key, unsigned char expanded[176]) {
+    memcpy(expanded, key, 16);
+    for (int i = 4; i < 44; i++) {
+        unsigned char temp[4];
+        memcpy(temp, expanded + (i - 1) * 4, 4);
+        if (i % 4 == 0) {
+            // RotWord, SubWord, Rcon
+            unsigned char t = temp[0];
+            temp[0] = aes_sbox[temp[1]] ^ aes_rcon[i / 4];
+            temp[1] = aes_sbox[temp[2]];
+            temp[2] = aes_sbox[temp[3]];
+            temp[3] = aes_sbox[t];
+        }
+        for (int k = 0; k < 4; k++) expanded[i * 4 + k] = expanded[(i - 4) * 4 + k] ^ temp[k];
+    }
+}
+
+static inline void aes_sub_bytes(unsigned char state[4][4]) {
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++) state[r][c] = aes_sbox[state[r][c]];
+}
+
+static inline void aes_inv_sub_bytes(unsigned char state[4][4]) {
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++) state[r][c] = aes_inv_sbox[state[r][c]];
+}
+
+// Row r rotates left by r
+static inline void aes_shift_rows(unsigned char state[4][4]) {
+    for (int r = 1; r < 4; r++) {
+        unsigned char row[4];
+        for (int c = 0; c < 4; c++) row[c] = state[r][(c + r) & 3];
+        memcpy(state[r], row, 4);
+    }
+}
+
+static inline void aes_inv_shift_rows(unsigned char state[4][4]) {
+    for (int r = 1; r < 4; r++) {
+        unsigned char row[4];
+        for (int c = 0; c < 4; c++) row[(c + r) & 3] = state[r][c];
+        memcpy(state[r], row, 4);
+    }
+}
+
+// Each column times {03}x^3 + {01}x^2 + {01}x + {02}; {02}a is xtime(a) and
+// {03}a is xtime(a) ^ a, so no general multiplication is needed
+static inline void aes_mix_columns(unsigned char state[4][4]) {
+    for (int c = 0; c < 4; c++) {
+        unsigned char a0 = state[0][c], a1 = state[1][c], a2 = state[2][c], a3 = state[3][c];
+        unsigned char all = a0 ^ a1 ^ a2 ^ a3;
+        state[0][c] = a0 ^ all ^ aes_xtime(a0 ^ a1);
+        state[1][c] = a1 ^ all ^ aes_xtime(a1 ^ a2);
+        state[2][c] = a2 ^ all ^ aes_xtime(a2 ^ a3);
+        state[3][c] = a3 ^ all ^ aes_xtime(a3 ^ a0);
+    }
+}
+
+static inline void aes_inv_mix_columns(unsigned char state[4][4]) {
+    for (int c = 0; c < 4; c++) {
+        unsigned char col[4] = {state[0][c], state[1][c], state[2][c], state[3][c]};
+        state[0][c] = aes_gf_mul(0x0e, col[0]) ^ aes_gf_mul(0x0b, col[1]) ^ aes_gf_mul(0x0d, col[2]) ^ aes_gf_mul(0x09, col[3]);
+        state[1][c] = aes_gf_mul(0x09, col[0]) ^ aes_gf_mul(0x0e, col[1]) ^ aes_gf_mul(0x0b, col[2]) ^ aes_gf_mul(0x0d, col[3]);
+        state[2][c] = aes_gf_mul(0x0d, col[0]) ^ aes_gf_mul(0x09, col[1]) ^ aes_gf_mul(0x0e, col[2]) ^ aes_gf_mul(0x0b, col[3]);
+        state[3][c] = aes_gf_mul(0x0b, col[0]) ^ aes_gf_mul(0x0d, col[1]) ^ aes_gf_mul(0x09, col[2]) ^ aes_gf_mul(0x0e, col[3]);
+    }
+}
+
+static inline void aes_add_round_key(unsigned char state[4][4], const unsigned char *expanded, int round) {
+    int offset = round * 16;
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++) state[r][c] ^= expanded[offset + 4 * c + r];
+}
+
+// --- Blocks ------------------------------------------------------------------
+
+typedef struct {
+    unsigned char rk[176];  // expanded key
+    unsigned char ctr[16];  // next CTR counter block
+} aes128_ctx;
+
+static inline void aes128_init(aes128_ctx *ctx, const unsigned char key[16]) {
+    aes_expand_key(key, ctx->rk);
+    memset(ctx->ctr, 0, sizeof(ctx->ctr));
+}
+
+static inline void aes128_encrypt_scalar(const aes128_ctx *ctx, const unsigned char *in, unsigned char *out) {
+    unsigned char state[4][4];
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++) state[r][c] = in[4 * c + r];
+
+    aes_add_round_key(state, ctx->rk, 0);
+    for (int round = 1; round < 10; round++) {
+        aes_sub_bytes(state);
+        aes_shift_rows(state);
+        aes_mix_columns(state);
+        aes_add_round_key(state, ctx->rk, round);
+    }
+    aes_sub_bytes(state);
+    aes_shift_rows(state);
+    aes_add_round_key(state, ctx->rk, 10);
+
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++) out[4 * c + r] = state[r][c];
+}
+
+static inline void aes128_decrypt(const aes128_ctx *ctx, const unsigned char *in, unsigned char *out) {
+    unsigned char state[4][4];
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++) state[r][c] = in[4 * c + r];
+
+    aes_add_round_key(state, ctx->rk, 10);
+    for (int round = 9; round > 0; round--) {
+        aes_inv_shift_rows(state);
+        aes_inv_sub_bytes(state);
+        aes_add_round_key(state, ctx->rk, round);
+        aes_inv_mix_columns(state);
+    }
+    aes_inv_shift_rows(state);
+    aes_inv_sub_bytes(state);
+    aes_add_round_key(state, ctx->rk, 0);
+
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++) out[4 * c + r] = state[r][c];
+}
+
+// --- CTR mode ----------------------------------------------------------------
+
+static inline void aes128_ctr_start(aes128_ctx *ctx, const unsigned char nonce[12], uint32_t counter) {
+    memcpy(ctx->ctr, nonce, 12);
+    ctx->ctr[12] = (unsigned char)(counter >> 24);
+    ctx->ctr[13] = (unsigned char)(counter >> 16);
+    ctx->ctr[14] = (unsigned char)(counter >> 8);
+    ctx->ctr[15] = (unsigned char)counter;
+}
+
+static inline void aes128_ctr_scalar(aes128_ctx *ctx, const unsigned char *in, unsigned char *out, size_t len) {
+    unsigned char ks[16];
+    for (size_t pos = 0; pos < len; pos += 16) {
+        aes128_encrypt_scalar(ctx, ctx->ctr, ks);
+        for (int i = 15; i >= 12 && ++ctx->ctr[i] == 0; i--) {}
+        size_t k = len - pos < 16 ? len - pos : 16;
+        for (size_t i = 0; i < k; i++) out[pos + i] = in[pos + i] ^ ks[i];
+    }
+}
+
+// --- AES-NI ------------------------------------------------------------------
+// The expanded key bytes are the round keys in the order AESENC expects.
+
+__attribute__((target("aes,sse2")))
+static void aes128_encrypt_aesni(const aes128_ctx *ctx, const unsigned char *in, unsigned char *out) {
+    __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), _mm_loadu_si128((const __m128i *)ctx->rk));
+    for (int round = 1; round < 10; round++)
+        b = _mm_aesenc_si128(b, _mm_loadu_si128((const __m128i *)(ctx->rk + 16 * round)));
+    b = _mm_aesenclast_si128(b, _mm_loadu_si128((const __m128i *)(ctx->rk + 160)));
+    _mm_storeu_si128((__m128i *)out, b);
+}
+
+__attribute__((target("aes,sse4.1")))
+static void aes128_ctr_aesni(aes128_ctx *ctx, const unsigned char *in, unsigned char *out, size_t len) {
+    __m128i rk[11];
+    for (int round = 0; round < 11; round++) rk[round] = _mm_loadu_si128((const __m128i *)(ctx->rk + 16 * round));
+    __m128i base = _mm_loadu_si128((const __m128i *)ctx->ctr);
+    uint32_t counter = (uint32_t)ctx->ctr[12] << 24 | (uint32_t)ctx->ctr[13] << 16 |
+                       (uint32_t)ctx->ctr[14] << 8 | ctx->ctr[15];
+    size_t pos = 0;
+    for (; len - pos >= 16 * AES_NI_LANES; pos += 16 * AES_NI_LANES) {
+        __m128i b[AES_NI_LANES];
+        for (int j = 0; j < AES_NI_LANES; j++)
+            b[j] = _mm_xor_si128(_mm_insert_epi32(base, (int)__builtin_bswap32(counter + (uint32_t)j), 3), rk[0]);
+        for (int round = 1; round < 10; round++)
+            for (int j = 0; j < AES_NI_LANES; j++) b[j] = _mm_aesenc_si128(b[j], rk[round]);
+        for (int j = 0; j < AES_NI_LANES; j++) {
+            b[j] = _mm_aesenclast_si128(b[j], rk[10]);
+            __m128i x = _mm_loadu_si128((const __m128i *)(in + pos + 16 * j));
+            _mm_storeu_si128((__m128i *)(out + pos + 16 * j), _mm_xor_si128(x, b[j]));
+        }
+        counter += AES_NI_LANES;
+    }
+    for (; pos < len; pos += 16) {
+        __m128i b = _mm_xor_si128(_mm_insert_epi32(base, (int)__builtin_bswap32(counter++), 3), rk[0]);
+        for (int round = 1; round < 10; round++) b = _mm_aesenc_si128(b, rk[round]);
+        b = _mm_aesenclast_si128(b, rk[10]);
+        unsigned char ks[16];
+        _mm_storeu_si128((__m128i *)ks, b);
+        size_t k = len - pos < 16 ? len - pos : 16;
+        for (size_t i = 0; i < k; i++) out[pos + i] = in[pos + i] ^ ks[i];
+    }
+    ctx->ctr[12] = (unsigned char)(counter >> 24);
+    ctx->ctr[13] = (unsigned char)(counter >> 16);
+    ctx->ctr[14] = (unsigned char)(counter >> 8);
+    ctx->ctr[15] = (unsigned char)counter;
+}
+
+// --- Dispatch ----------------------------------------------------------------
+
+typedef struct {
+    cpu_impl impl;
+    void (*encrypt)(const aes128_ctx *ctx, const unsigned char *in, unsigned char *out);
+    void (*ctr)(aes128_ctx *ctx, const unsigned char *in, unsigned char *out, size_t len);
+} aes_kernel;
+
+static const aes_kernel aes_kernels[] = {
+    {{"aesni", CPU_AESNI | CPU_SSE41, 0}, aes128_encrypt_aesni, aes128_ctr_aesni},
+    {{"scalar", 0, 0}, aes128_encrypt_scalar, aes128_ctr_scalar},
+};
+#define AES_NKERNELS (int)(sizeof(aes_kernels) / sizeof(aes_kernels[0]))
+
+// FIPS-197 Appendix B, and SP 800-38A F.5.1 followed by zeros up to 37 blocks
+// plus a partial one, checked against the scalar kernel past the vector
+static inline int aesKernelSelfTest(int i) {
+    static const unsigned char key[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                          0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    static const unsigned char fips_pt[16] = {0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d,
+                                              0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34};
+    static const unsigned char fips_ct[16] = {0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb,
+                                              0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32};
+    static const unsigned char ctr_iv[16] = {0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+                                             0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff};
+    static const unsigned char ctr_pt[64] = {
+        0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+        0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+        0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+        0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+    static const unsigned char ctr_ct[64] = {
+        0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26, 0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+        0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff, 0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+        0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e, 0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+        0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1, 0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee};
+    const aes_kernel *k = &aes_kernels[i];
+    aes128_ctx ctx, ref;
+    unsigned char pt[37 * 16 + 5] = {0}, ct[sizeof(pt)], want[sizeof(pt)], block[16];
+    aes128_init(&ctx, key);
+    k->encrypt(&ctx, fips_pt, block);
+    if (memcmp(block, fips_ct, 16) != 0) return 0;
+
+    memcpy(pt, ctr_pt, sizeof(ctr_pt));
+    memcpy(ctx.ctr, ctr_iv, 16);
+    k->ctr(&ctx, pt, ct, sizeof(pt));
+    if (memcmp(ct, ctr_ct, sizeof(ctr_ct)) != 0) return 0;
+    aes128_init(&ref, key);
+    memcpy(ref.ctr, ctr_iv, 16);
+    aes128_ctr_scalar(&ref, pt, want, sizeof(pt));
+    return memcmp(ct, want, sizeof(pt)) == 0 && memcmp(ctx.ctr, ref.ctr, 16) == 0;
+}
+
+static int aes_kernel_cached = -1;
+
+static inline const aes_kernel *aes_impl(void) {
+    int k = __atomic_load_n(&aes_kernel_cached, __ATOMIC_RELAXED);
+    if (k < 0) {
+        k = CPU_SELECT("AES_IMPL", aes_kernels, aesKernelSelfTest);
+        __atomic_store_n(&aes_kernel_cached, k, __ATOMIC_RELAXED);
+    }
+    return &aes_kernels[k];
+}
+
+static inline void aes128_encrypt(const aes128_ctx *ctx, const unsigned char *in, unsigned char *out) {
+    aes_impl()->encrypt(ctx, in, out);
+}
+
+// out = in ^ keystream (encryption and decryption are the same). Every call
+// starts on a fresh keystream block: the unused tail of a partial last block
+// is dropped.
+static inline void aes128_ctr(aes128_ctx *ctx, const unsigned char *in, unsigned char *out, size_t len) {
+    aes_impl()->ctr(ctx, in, out, len);
+}
+
+static inline void aes_encrypt_block(const unsigned char *in, unsigned char *out, const unsigned char *key) {
+    aes128_ctx ctx;
+    aes128_init(&ctx, key);
+    aes128_encrypt(&ctx, in, out);
+}
+
+static inline void aes_decrypt_block(const unsigned char *in, unsigned char *out, const unsigned char *key) {
+    aes128_ctx ctx;
+    aes128_init(&ctx, key);
+    aes128_decrypt(&ctx, in, out);
+}
+
+#endif // AES_H
@@ -0,0 +1,74 @@
+// benchutil.h
+// Helpers shared by the benchmark programs:
+//   now_seconds      - CLOCK_MONOTONIC wall time in seconds
+//   read_tsc         - time stamp counter, fenced on both sides so earlier
+//                      work has finished before the read and later work does
+//                      not start until it is done (nanoseconds off x86)
+//   random_seed64    - a 64-bit experiment seed from /dev/urandom, or time and
+//                      pid if that fails; print it so a run can be reproduced
+//   splitmix64       - SplitMix64 output function of x: a well-mixed 64-bit
+//                      hash, e.g. to derive stream seeds from (seed, index)
+//   splitmix64_next  - the SplitMix64 generator: next value of the state *s
+//   is_sorted        - whether arr[0..n-1] is in ascending order
+
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static inline double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static inline uint64_t read_tsc(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    return (uint64_t)(now_seconds() * 1e9);
+#endif
+}
+
+static inline uint64_t random_seed64(void) {
+    uint64_t seed;
+    FILE *urnd = fopen("/dev/urandom", "rb");
+    if (urnd) {
+        if (fread(&seed, 1, sizeof(seed), urnd) == sizeof(seed)) {
+            fclose(urnd);
+            return seed;
+        }
+        fclose(urnd);
+    }
+    return (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+}
+
+static inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static inline uint64_t splitmix64_next(uint64_t *s) {
+    uint64_t x = *s;
+    *s += 0x9e3779b97f4a7c15ULL;
+    return splitmix64(x);
+}
+
+static inline int is_sorted(const int arr[], int n) {
+    for (int i = 1; i < n; i++)
+        if (arr[i - 1] > arr[i]) return 0;
+    return 1;
+}
+
+#endif // BENCHUTIL_H
@@ -0,0 +1,278 @@
+// chacha.h
+// ChaCha20 (RFC 8439), shared by chacha.c and cipherbench.c.
+//   chacha20_block        - the block function: 20 rounds over a 16-word state
+//                           and the feed-forward addition
+//   chacha20_ctx          - state of a keystream: constants, 256-bit key,
+//                           32-bit block counter and 96-bit nonce
+//   chacha20_init         - key, nonce and first counter into a context
+//   chacha20_xor          - encrypts or decrypts, advancing the counter
+// Key and nonce bytes are read as little-endian words; the keystream is
+// written out the same way, which makes the XOR a word operation on
+// little-endian hosts.
+// chacha20_xor runs on the kernel picked by cpudispatch.h (CHACHA_IMPL=name):
+//   avx512 - 16 blocks at once, word i of every block in one ZMM register
+//   avx2   - 8 blocks at once in YMM registers
+//   scalar - one block at a time with chacha20_block
+// The vector kernels transpose their registers back to block order in
+// registers (4x4 word transposes in each 128-bit lane, then across lanes) and
+// hand the last partial batch to the scalar kernel. A kernel must reproduce
+// the RFC 8439 2.4.2 vector and the scalar keystream over several batches
+// before it is used.
+
+#ifndef CHACHA_H
+#define CHACHA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "cpudispatch.h"
+
+#define CHACHA_ROUNDS 20  // ChaCha20
+
+#define CHACHA_ROTL(a,b) (((a) << (b)) | ((a) >> (32 - (b))))
+
+#define CHACHA_QR(a, b, c, d)        \
+    a += b; d ^= a; d = CHACHA_ROTL(d,16); \
+    c += d; b ^= c; b = CHACHA_ROTL(b,12); \
+    a += b; d ^= a; d = CHACHA_ROTL(d, 8); \
+    c += d; b ^= c; b = CHACHA_ROTL(b, 7);
+
+static inline void chacha20_block(uint32_t out[16], const uint32_t in[16]) {
+    int i;
+    uint32_t x[16];
+    memcpy(x, in, sizeof(x));
+
+    for (i = 0; i < CHACHA_ROUNDS; i += 2) {
+        // Odd round
+        CHACHA_QR(x[0], x[4], x[8], x[12])
+        CHACHA_QR(x[1], x[5], x[9], x[13])
+        CHACHA_QR(x[2], x[6], x[10], x[14])
+        CHACHA_QR(x[3], x[7], x[11], x[15])
+        // Even round
+        CHACHA_QR(x[0], x[5], x[10], x[15])
+        CHACHA_QR(x[1], x[6], x[11], x[12])
+        CHACHA_QR(x[2], x[7], x[8], x[13])
+        CHACHA_QR(x[3], x[4], x[9], x[14])
+    }
+
+    for (i = 0; i < 16; ++i) {
+        out[i] = x[i] + in[i];
+    }
+}
+
+typedef struct {
+    uint32_t state[16];  // state[12] is the counter of the next block
+} chacha20_ctx;
+
+static inline uint32_t chacha_load32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void chacha20_init(chacha20_ctx *ctx, const unsigned char key[32],
+                                 const unsigned char nonce[12], uint32_t counter) {
+    ctx->state[0] = 0x61707865;  // "expand 32-byte k"
+    ctx->state[1] = 0x3320646e;
+    ctx->state[2] = 0x79622d32;
+    ctx->state[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) ctx->state[4 + i] = chacha_load32(key + 4 * i);
+    ctx->state[12] = counter;
+    for (int i = 0; i < 3; i++) ctx->state[13 + i] = chacha_load32(nonce + 4 * i);
+}
+
+static inline void chacha20_xor_scalar(chacha20_ctx *ctx, const unsigned char *in, unsigned char *out, size_t len) {
+    uint32_t ks[16];
+    size_t pos = 0;
+    for (; pos + 64 <= len; pos += 64) {
+        chacha20_block(ks, ctx->state);
+        ctx->state[12]++;
+        for (int i = 0; i < 16; i++) {
+            uint32_t w = chacha_load32(in + pos + 4 * i) ^ ks[i];
+            memcpy(out + pos + 4 * i, &w, 4);  // little-endian store
+        }
+    }
+    if (pos < len) {
+        chacha20_block(ks, ctx->state);
+        ctx->state[12]++;
+        for (size_t i = 0; pos + i < len; i++)
+            out[pos + i] = in[pos + i] ^ (unsigned char)(ks[i / 4] >> (8 * (i % 4)));
+    }
+}
+
+// --- Vector kernels ----------------------------------------------------------
+// Lane j of register x[i] holds word i of block counter + j.
+
+#define CHACHA_VQR(a, b, c, d, ADD, XOR, ROL16, ROL12, ROL8, ROL7) \
+    a = ADD(a, b); d = XOR(d, a); d = ROL16(d);                   \
+    c = ADD(c, d); b = XOR(b, c); b = ROL12(b);                   \
+    a = ADD(a, b); d = XOR(d, a); d = ROL8(d);                    \
+    c = ADD(c, d); b = XOR(b, c); b = ROL7(b);
+
+#define CHACHA_VROUNDS(x, ADD, XOR, ROL16, ROL12, ROL8, ROL7)                        \
+    for (int r = 0; r < CHACHA_ROUNDS; r += 2) {                                       \
+        CHACHA_VQR(x[0], x[4], x[8], x[12], ADD, XOR, ROL16, ROL12, ROL8, ROL7)       \
+        CHACHA_VQR(x[1], x[5], x[9], x[13], ADD, XOR, ROL16, ROL12, ROL8, ROL7)       \
+        CHACHA_VQR(x[2], x[6], x[10], x[14], ADD, XOR, ROL16, ROL12, ROL8, ROL7)      \
+        CHACHA_VQR(x[3], x[7], x[11], x[15], ADD, XOR, ROL16, ROL12, ROL8, ROL7)      \
+        CHACHA_VQR(x[0], x[5], x[10], x[15], ADD, XOR, ROL16, ROL12, ROL8, ROL7)      \
+        CHACHA_VQR(x[1], x[6], x[11], x[12], ADD, XOR, ROL16, ROL12, ROL8, ROL7)      \
+        CHACHA_VQR(x[2], x[7], x[8], x[13], ADD, XOR, ROL16, ROL12, ROL8, ROL7)       \
+        CHACHA_VQR(x[3], x[4], x[9], x[14], ADD, XOR, ROL16, ROL12, ROL8, ROL7)       \
+    }
+
+// 4x4 transpose of words in every 128-bit lane: afterwards lane L of a0..a3
+// holds words (a0..a3)[4L + 0] .. [4L + 3] respectively
+#define CHACHA_TRANSPOSE4(a0, a1, a2, a3, T, UNLO32, UNHI32, UNLO64, UNHI64) { \
+    T t0 = UNLO32(a0, a1), t1 = UNHI32(a0, a1);                                  \
+    T t2 = UNLO32(a2, a3), t3 = UNHI32(a2, a3);                                  \
+    a0 = UNLO64(t0, t2); a1 = UNHI64(t0, t2);                                    \
+    a2 = UNLO64(t1, t3); a3 = UNHI64(t1, t3);                                    \
+}
+
+#define CHACHA_ADD256(a, b) _mm256_add_epi32(a, b)
+#define CHACHA_XOR256(a, b) _mm256_xor_si256(a, b)
+#define CHACHA_ROL256(a, n) _mm256_or_si256(_mm256_slli_epi32(a, n), _mm256_srli_epi32(a, 32 - (n)))
+#define CHACHA_ROL256_16(a) _mm256_shuffle_epi8(a, rot16)
+#define CHACHA_ROL256_12(a) CHACHA_ROL256(a, 12)
+#define CHACHA_ROL256_8(a) _mm256_shuffle_epi8(a, rot8)
+#define CHACHA_ROL256_7(a) CHACHA_ROL256(a, 7)
+
+__attribute__((target("avx2")))
+static void chacha20_xor_avx2(chacha20_ctx *ctx, const unsigned char *in, unsigned char *out, size_t len) {
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                          3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+    size_t pos = 0;
+    for (; len - pos >= 8 * 64; pos += 8 * 64) {
+        __m256i s[16], x[16];
+        for (int i = 0; i < 16; i++) s[i] = _mm256_set1_epi32((int)ctx->state[i]);
+        s[12] = _mm256_add_epi32(s[12], _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        memcpy(x, s, sizeof(x));
+        CHACHA_VROUNDS(x, CHACHA_ADD256, CHACHA_XOR256, CHACHA_ROL256_16, CHACHA_ROL256_12,
+                       CHACHA_ROL256_8, CHACHA_ROL256_7)
+        for (int i = 0; i < 16; i++) x[i] = _mm256_add_epi32(x[i], s[i]);
+        for (int g = 0; g < 16; g += 4)
+            CHACHA_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3], __m256i, _mm256_unpacklo_epi32,
+                              _mm256_unpackhi_epi32, _mm256_unpacklo_epi64, _mm256_unpackhi_epi64)
+        // Block 4L + e is lane L of x[e], x[4 + e], x[8 + e], x[12 + e]
+        for (int e = 0; e < 4; e++) {
+            for (int h = 0; h < 2; h++) {   // words 0-7, then 8-15
+                __m256i lo = x[8 * h + e], hi = x[8 * h + 4 + e];
+                __m256i blk[2] = {_mm256_permute2x128_si256(lo, hi, 0x20),
+                                  _mm256_permute2x128_si256(lo, hi, 0x31)};
+                for (int L = 0; L < 2; L++) {
+                    size_t off = pos + 64 * (size_t)(4 * L + e) + 32 * (size_t)h;
+                    __m256i m = _mm256_loadu_si256((const __m256i *)(in + off));
+                    _mm256_storeu_si256((__m256i *)(out + off), _mm256_xor_si256(m, blk[L]));
+                }
+            }
+        }
+        ctx->state[12] += 8;
+    }
+    if (pos < len) chacha20_xor_scalar(ctx, in + pos, out + pos, len - pos);
+}
+
+#define CHACHA_ADD512(a, b) _mm512_add_epi32(a, b)
+#define CHACHA_XOR512(a, b) _mm512_xor_si512(a, b)
+#define CHACHA_ROL512_16(a) _mm512_rol_epi32(a, 16)
+#define CHACHA_ROL512_12(a) _mm512_rol_epi32(a, 12)
+#define CHACHA_ROL512_8(a) _mm512_rol_epi32(a, 8)
+#define CHACHA_ROL512_7(a) _mm512_rol_epi32(a, 7)
+
+__attribute__((target("avx512f")))
+static void chacha20_xor_avx512(chacha20_ctx *ctx, const unsigned char *in, unsigned char *out, size_t len) {
+    size_t pos = 0;
+    for (; len - pos >= 16 * 64; pos += 16 * 64) {
+        __m512i s[16], x[16];
+        for (int i = 0; i < 16; i++) s[i] = _mm512_set1_epi32((int)ctx->state[i]);
+        s[12] = _mm512_add_epi32(s[12], _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+        memcpy(x, s, sizeof(x));
+        CHACHA_VROUNDS(x, CHACHA_ADD512, CHACHA_XOR512, CHACHA_ROL512_16, CHACHA_ROL512_12,
+                       CHACHA_ROL512_8, CHACHA_ROL512_7)
+        for (int i = 0; i < 16; i++) x[i] = _mm512_add_epi32(x[i], s[i]);
+        for (int g = 0; g < 16; g += 4)
+            CHACHA_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3], __m512i, _mm512_unpacklo_epi32,
+                              _mm512_unpackhi_epi32, _mm512_unpacklo_epi64, _mm512_unpackhi_epi64)
+        // Block 4L + e is lane L of x[e], x[4 + e], x[8 + e], x[12 + e]:
+        // a 4x4 transpose of 128-bit lanes
+        for (int e = 0; e < 4; e++) {
+            __m512i a = _mm512_shuffle_i32x4(x[e], x[4 + e], _MM_SHUFFLE(1, 0, 1, 0));
+            __m512i b = _mm512_shuffle_i32x4(x[e], x[4 + e], _MM_SHUFFLE(3, 2, 3, 2));
+            __m512i c = _mm512_shuffle_i32x4(x[8 + e], x[12 + e], _MM_SHUFFLE(1, 0, 1, 0));
+            __m512i d = _mm512_shuffle_i32x4(x[8 + e], x[12 + e], _MM_SHUFFLE(3, 2, 3, 2));
+            __m512i blk[4] = {_mm512_shuffle_i32x4(a, c, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm512_shuffle_i32x4(a, c, _MM_SHUFFLE(3, 1, 3, 1)),
+                              _mm512_shuffle_i32x4(b, d, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm512_shuffle_i32x4(b, d, _MM_SHUFFLE(3, 1, 3, 1))};
+            for (int L = 0; L < 4; L++) {
+                size_t off = pos + 64 * (size_t)(4 * L + e);
+                __m512i m = _mm512_loadu_si512((const void *)(in + off));
+                _mm512_storeu_si512((void *)(out + off), _mm512_xor_si512(m, blk[L]));
+            }
+        }
+        ctx->state[12] += 16;
+    }
+    if (pos < len) chacha20_xor_scalar(ctx, in + pos, out + pos, len - pos);
+}
+
+// --- Dispatch ----------------------------------------------------------------
+
+typedef struct {
+    cpu_impl impl;
+    void (*xor_stream)(chacha20_ctx *ctx, const unsigned char *in, unsigned char *out, size_t len);
+} chacha_kernel;
+
+static const chacha_kernel chacha_kernels[] = {
+    {{"avx512", CPU_AVX512F, 0}, chacha20_xor_avx512},
+    {{"avx2", CPU_AVX2, 0}, chacha20_xor_avx2},
+    {{"scalar", 0, 0}, chacha20_xor_scalar},
+};
+
+// RFC 8439 2.4.2: the plaintext followed by zeros up to 37 blocks plus a
+// partial one, checked against the scalar kernel past the vector
+static inline int chachaKernelSelfTest(int i) {
+    static const char text[] = "Ladies and Gentlemen of the class of '99: If I could offer you "
+                               "only one tip for the future, sunscreen would be it.";
+    static const unsigned char want_ct[114] = {
+        0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+        0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2, 0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+        0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab, 0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+        0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab, 0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+        0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61, 0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+        0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06, 0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+        0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6, 0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+        0x87, 0x4d};
+    static const unsigned char nonce[12] = {0, 0, 0, 0, 0, 0, 0, 0x4a, 0, 0, 0, 0};
+    unsigned char key[32], pt[37 * 64 + 5] = {0}, ct[sizeof(pt)], want[sizeof(pt)];
+    for (int b = 0; b < 32; b++) key[b] = (unsigned char)b;
+    memcpy(pt, text, sizeof(want_ct));
+
+    chacha20_ctx ctx, ref;
+    chacha20_init(&ctx, key, nonce, 1);
+    chacha_kernels[i].xor_stream(&ctx, pt, ct, sizeof(pt));
+    if (memcmp(ct, want_ct, sizeof(want_ct)) != 0) return 0;
+    chacha20_init(&ref, key, nonce, 1);
+    chacha20_xor_scalar(&ref, pt, want, sizeof(pt));
+    return memcmp(ct, want, sizeof(pt)) == 0 && ctx.state[12] == ref.state[12];
+}
+
+static int chacha_kernel_cached = -1;
+
+static inline const chacha_kernel *chacha_impl(void) {
+    int k = __atomic_load_n(&chacha_kernel_cached, __ATOMIC_RELAXED);
+    if (k < 0) {
+        k = CPU_SELECT("CHACHA_IMPL", chacha_kernels, chachaKernelSelfTest);
+        __atomic_store_n(&chacha_kernel_cached, k, __ATOMIC_RELAXED);
+    }
+    return &chacha_kernels[k];
+}
+
+// out = in ^ keystream. Every call starts on a fresh keystream block: the
+// unused tail of a partial last block is dropped.
+static inline void chacha20_xor(chacha20_ctx *ctx, const unsigned char *in, unsigned char *out, size_t len) {
+    chacha_impl()->xor_stream(ctx, in, out, len);
+}
+
+#endif // CHACHA_H
@@ -0,0 +1,47 @@
+import matplotlib.pyplot as plt
+import pandas as pd
+
+# Read the CSV file written by cipherbench.c
+data = pd.read_csv("cipher_bench.csv")
+ciphers = data['Cipher'].unique()
+markers = ['o', 's', '^', 'd', 'x', 'v']
+
+# -------- Plot Cycles per Byte (one thread) --------
+plt.figure(figsize=(10, 6))
+one = data[data['Threads'] == 1]
+for i, cipher in enumerate(ciphers):
+    for mode, style in [('warm', '-'), ('cold', '--')]:
+        rows = one[(one['Cipher'] == cipher) & (one['KeyMode'] == mode)]
+        plt.plot(rows['MessageBytes'], rows['CyclesPerByte'], style,
+                 label=f'{cipher} ({mode} key)', marker=markers[i % len(markers)])
+
+plt.xscale('log')
+plt.yscale('log')
+plt.xlabel('Message Size (bytes)')
+plt.ylabel('Median Cycles per Byte')
+plt.title('Cycles per Byte vs Message Size (1 thread)')
+plt.legend()
+plt.grid(True)
+
+cpb_img = "cipher_cycles_per_byte.png"
+plt.savefig(cpb_img, dpi=300)
+plt.show()
+print(f"Saved cycles per byte plot as: {cpb_img}")
+
+# -------- Plot Throughput vs Threads (largest message, warm key) --------
+plt.figure(figsize=(10, 6))
+warm = data[(data['KeyMode'] == 'warm') & (data['MessageBytes'] == data['MessageBytes'].max())]
+for i, cipher in enumerate(ciphers):
+    rows = warm[warm['Cipher'] == cipher]
+    plt.plot(rows['Threads'], rows['GBps'], label=cipher, marker=markers[i % len(markers)])
+
+plt.xlabel('Threads')
+plt.ylabel('GB/s (all threads)')
+plt.title(f"Throughput vs Threads ({data['MessageBytes'].max()}-byte messages, warm key)")
+plt.legend()
+plt.grid(True)
+
+gbps_img = "cipher_throughput.png"
+plt.savefig(gbps_img, dpi=300)
+plt.show()
+print(f"Saved throughput plot as: {gbps_img}")
@@ -0,0 +1,146 @@
+// cpudispatch.h
+// CPU feature detection and kernel selection shared by the headers with
+// ISA-specific paths (aes.h, chacha.h, simdsort.h, multiexp.h).
+//   cpu_features  - CPU_* bits, detected once per process with cpuid. AVX and
+//                   AVX-512 features count only when xgetbv shows that the OS
+//                   saves their registers (XCR0), as a kernel using them
+//                   would otherwise fault.
+//   cpu_select    - picks an implementation from a family's table, best
+//                   first: the first one the CPU can run whose self-test
+//                   passes. A failed self-test is reported on stderr and the
+//                   next entry is tried, so the last entry must be the
+//                   portable one with no requirements.
+// Overrides, for benchmarking one binary on several paths:
+//   <FAMILY>_IMPL=name    - the family's variable (AES_IMPL, CHACHA_IMPL,
+//                           SIMDSORT_IMPL, MEXP_IMPL, SHA256_IMPL,
+//                           SHA256_MB_IMPL) forces an entry by name
+//                           if the CPU has it and it passes its self-test
+//   CPU_DISABLE=f1,f2,... - hides features from every family, by the names in
+//                           cpu_feature_names ("all" hides everything), like
+//                           running on an older CPU
+
+#ifndef CPUDISPATCH_H
+#define CPUDISPATCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+enum {
+    CPU_SSE2 = 1u << 0,
+    CPU_SSSE3 = 1u << 1,
+    CPU_SSE41 = 1u << 2,
+    CPU_AESNI = 1u << 3,
+    CPU_PCLMUL = 1u << 4,
+    CPU_AVX = 1u << 5,
+    CPU_AVX2 = 1u << 6,
+    CPU_BMI2 = 1u << 7,
+    CPU_SHA = 1u << 8,
+    CPU_AVX512F = 1u << 9,
+    CPU_AVX512BW = 1u << 10,
+    CPU_AVX512VL = 1u << 11,
+    CPU_AVX512IFMA = 1u << 12,
+    CPU_VAES = 1u << 13,
+    CPU_NFEATURES = 14
+};
+
+static const char *const cpu_feature_names[CPU_NFEATURES] = {
+    "sse2", "ssse3", "sse4.1", "aesni", "pclmul", "avx", "avx2", "bmi2", "sha",
+    "avx512f", "avx512bw", "avx512vl", "avx512ifma", "vaes"};
+
+static inline unsigned cpuDetect(void) {
+    unsigned f = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) return 0;
+    if (d & (1u << 26)) f |= CPU_SSE2;
+    if (c & (1u << 9)) f |= CPU_SSSE3;
+    if (c & (1u << 19)) f |= CPU_SSE41;
+    if (c & (1u << 25)) f |= CPU_AESNI;
+    if (c & (1u << 1)) f |= CPU_PCLMUL;
+    unsigned long long xcr0 = 0;
+    if (c & (1u << 27)) { // OSXSAVE: xgetbv is available
+        unsigned lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0 = (unsigned long long)hi << 32 | lo;
+    }
+    int ymm = (xcr0 & 0x6) == 0x6;   // XMM and YMM state
+    int zmm = (xcr0 & 0xe6) == 0xe6; // plus opmask and ZMM state
+    if (ymm && (c & (1u << 28))) f |= CPU_AVX;
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        if (ymm && (b & (1u << 5))) f |= CPU_AVX2;
+        if (b & (1u << 8)) f |= CPU_BMI2;
+        if (b & (1u << 29)) f |= CPU_SHA;
+        if (ymm && (c & (1u << 9))) f |= CPU_VAES;
+        if (zmm && (b & (1u << 16))) {
+            f |= CPU_AVX512F;
+            if (b & (1u << 30)) f |= CPU_AVX512BW;
+            if (b & (1u << 31)) f |= CPU_AVX512VL;
+            if (b & (1u << 21)) f |= CPU_AVX512IFMA;
+        }
+    }
+#endif
+    const char *off = getenv("CPU_DISABLE");
+    if (off) {
+        if (strcmp(off, "all") == 0) return 0;
+        for (int i = 0; i < CPU_NFEATURES; i++) {
+            size_t len = strlen(cpu_feature_names[i]);
+            for (const char *p = strstr(off, cpu_feature_names[i]); p; p = strstr(p + 1, cpu_feature_names[i]))
+                if ((p == off || p[-1] == ',') && (p[len] == '\0' || p[len] == ','))
+                    f &= ~(1u << i);
+        }
+    }
+    return f;
+}
+
+// Detected once per process; the race on first use is benign (same answer).
+static int cpu_features_cached = -1;
+
+static inline unsigned cpu_features(void) {
+    int f = __atomic_load_n(&cpu_features_cached, __ATOMIC_RELAXED);
+    if (f < 0) {
+        f = (int)cpuDetect();
+        __atomic_store_n(&cpu_features_cached, f, __ATOMIC_RELAXED);
+    }
+    return (unsigned)f;
+}
+
+// --- Selection ---------------------------------------------------------------
+
+#define CPU_IMPL_MANUAL 1 // only used when forced by name (never auto-selected)
+
+// First member of every entry of a family's kernel table
+typedef struct {
+    const char *name;
+    unsigned needs; // CPU_* bits
+    int flags;      // CPU_IMPL_*
+} cpu_impl;
+
+// Index of the entry to use in a table of n entries of stride bytes whose
+// first member is a cpu_impl. self_test(i) returns nonzero if entry i works.
+static inline int cpu_select(const char *env, const void *table, size_t stride, int n,
+                             int (*self_test)(int)) {
+    unsigned have = cpu_features();
+#define CPU_ENTRY(i) ((const cpu_impl *)((const char *)table + (size_t)(i) * stride))
+    const char *force = getenv(env);
+    for (int pass = force ? 0 : 1; pass < 2; pass++) {
+        for (int i = 0; i < n; i++) {
+            const cpu_impl *e = CPU_ENTRY(i);
+            if ((e->needs & have) != e->needs) continue;
+            if (pass == 0 ? strcmp(force, e->name) != 0 : (e->flags & CPU_IMPL_MANUAL) != 0) continue;
+            if (self_test(i)) return i;
+            fprintf(stderr, "%s: %s kernel failed its self-test, not used\n", env, e->name);
+        }
+    }
+#undef CPU_ENTRY
+    return n - 1;
+}
+
+#define CPU_SELECT(env, table, self_test) \
+    cpu_select((env), (table), sizeof((table)[0]), (int)(sizeof(table) / sizeof((table)[0])), (self_test))
+
+#endif // CPUDISPATCH_H
@@ -0,0 +1,119 @@
+// dheap.h
+// d-ary heaps with Floyd's bottom-up sift-down:
+//   dheap                  - min-priority queue of (key, value) items with a
+//                            power-of-two arity chosen at init. Its storage is
+//                            offset so every group of siblings starts on a
+//                            multiple of its own size: with d = 8 the children
+//                            of a node fill exactly one 64-byte cache line.
+// The 4- and 8-ary heap sorts built on the same sift, heapSort4 and heapSort8,
+// are in sorting_impl.h with the other sorts, under every counting policy.
+// A d-ary heap is log2(d) times shallower than a binary one, so a sift-down
+// touches that many fewer cache lines, and the d-1 comparisons that pick the
+// largest child read one line. Floyd's sift moves the hole all the way down
+// along the largest children without comparing against the sifted key, then
+// walks the key back up from the leaf; since the key removed from the bottom
+// almost always belongs near the bottom, the walk up is usually one or two
+// steps, which saves the comparison per level of the textbook sift.
+
+#ifndef DHEAP_H
+#define DHEAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Priority queue ----------------------------------------------------------
+
+typedef struct {
+    int key;
+    int value;
+} dheap_item;
+
+typedef struct {
+    dheap_item *items; // items[0] is the minimum
+    size_t size, cap;
+    void *mem;         // allocation holding items (at an offset)
+    int shift;         // log2 of the arity
+} dheap;
+
+// Storage for cap items such that items + 1 is aligned to d items; d - 1
+// items of padding sit in front.
+static inline int dheapAlloc(dheap *h, size_t cap) {
+    size_t d = (size_t)1 << h->shift;
+    size_t align = d * sizeof(dheap_item) < 64 ? d * sizeof(dheap_item) : 64;
+    size_t bytes = (cap + d) * sizeof(dheap_item);
+    bytes = (bytes + align - 1) / align * align;
+    void *mem = aligned_alloc(align, bytes);
+    if (mem == NULL) return -1;
+    dheap_item *items = (dheap_item *)mem + (d - 1);
+    if (h->items) memcpy(items, h->items, h->size * sizeof(dheap_item));
+    free(h->mem);
+    h->mem = mem;
+    h->items = items;
+    h->cap = cap;
+    return 0;
+}
+
+// arity must be a power of two (2, 4, 8 or 16). Returns 0, or -1 on bad
+// arguments or allocation failure.
+static inline int dheap_init(dheap *h, int arity, size_t cap) {
+    memset(h, 0, sizeof(*h));
+    if (arity < 2 || arity > 16 || (arity & (arity - 1)) != 0) return -1;
+    h->shift = __builtin_ctz((unsigned)arity);
+    return dheapAlloc(h, cap > 0 ? cap : 16);
+}
+
+static inline void dheap_destroy(dheap *h) {
+    free(h->mem);
+    memset(h, 0, sizeof(*h));
+}
+
+static inline const dheap_item *dheap_top(const dheap *h) {
+    return h->size ? &h->items[0] : NULL;
+}
+
+// Returns 0, or -1 if the queue could not grow.
+static inline int dheap_push(dheap *h, int key, int value) {
+    if (h->size == h->cap && dheapAlloc(h, 2 * h->cap) != 0) return -1;
+    size_t hole = h->size++;
+    dheap_item *it = h->items;
+    while (hole > 0) {
+        size_t parent = (hole - 1) >> h->shift;
+        if (it[parent].key <= key) break;
+        it[hole] = it[parent];
+        hole = parent;
+    }
+    it[hole].key = key;
+    it[hole].value = value;
+    return 0;
+}
+
+// Removes the minimum into *out. Returns 0 if the queue was empty.
+static inline int dheap_pop(dheap *h, dheap_item *out) {
+    if (h->size == 0) return 0;
+    dheap_item *it = h->items;
+    *out = it[0];
+    dheap_item x = it[--h->size];
+    size_t n = h->size, d = (size_t)1 << h->shift, hole = 0;
+    if (n == 0) return 1;
+    // Floyd: hole down along the smallest children, then x back up
+    for (;;) {
+        size_t first = (hole << h->shift) + 1;
+        if (first >= n) break;
+        size_t best = first, end = first + d < n ? first + d : n;
+        for (size_t c = first + 1; c < end; c++)
+            if (it[c].key < it[best].key) best = c;
+        it[hole] = it[best];
+        hole = best;
+    }
+    while (hole > 0) {
+        size_t parent = (hole - 1) >> h->shift;
+        if (it[parent].key <= x.key) break;
+        it[hole] = it[parent];
+        hole = parent;
+    }
+    it[hole] = x;
+    return 1;
+}
+
+#endif // DHEAP_H
@@ -0,0 +1,485 @@
+// extsort.c
+// External merge sort for files of 32-bit int records larger than memory.
+//   Run generation: the input is read in chunks of a third of the memory
+//   budget; each chunk is sorted in memory (simdSort, see simdsort.h) and
+//   appended to a temporary run file. Three chunk buffers rotate so that the
+//   next chunk is being read and the previous run written while one is sorted.
+//   Merging: runs are combined by a k-way loser tree (one comparison per tree
+//   level per record). Every run has two input buffers: one is consumed while
+//   the next block of the run is read into the other, and the output is
+//   double-buffered the same way. When there are more runs than the budget
+//   allows buffers for, merge passes over groups of runs repeat until one
+//   pass can write the output directly.
+// All reads and writes go through two I/O threads (one reading, one
+// writing) working down queues of requests, so the sorting or merging thread
+// blocks only when a buffer it needs is still in flight. The time it spent
+// blocked is reported per phase. If an I/O thread cannot be started, its
+// transfers are done synchronously by the caller instead.
+//
+// Build: gcc -O2 -pthread extsort.c
+// Usage: ./a.out input output [memory_MB] [tmpdir]   (default 256 MB, /tmp)
+//        ./a.out -g file records [seed]    write random records to file
+//        ./a.out -c file                   check that file is sorted
+// Records are native-endian int; the file size must be a multiple of 4.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "benchutil.h"
+#include "simdsort.h"
+
+#define EXT_BUF_MIN (64 << 10)  // smallest merge buffer; below this, merge in more passes
+#define EXT_ALIGN 4096          // buffer sizes are multiples of a page
+
+static void die(const char *what) {
+    fprintf(stderr, "%s: %s\n", what, strerror(errno));
+    exit(1);
+}
+
+// --- I/O threads ---------------------------------------------------------------
+
+typedef struct ext_io_job {
+    int fd;
+    int write;
+    void *buf;
+    size_t len;
+    off_t off;
+    int pending; // posted and not yet waited for
+    int done;
+    int error;   // errno of a failed transfer, 0 on success
+    struct ext_io_job *next;
+} ext_io_job;
+
+typedef struct {
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t work, done;
+    ext_io_job *head, *tail;
+    int stop;
+    int threaded;        // 0 if the thread could not be started: I/O is done in ext_io_post
+    double wait_seconds; // time callers spent blocked in ext_io_wait (or in synchronous I/O)
+} ext_io_queue;
+
+// Performs the whole transfer, retrying short reads and writes
+static int ext_io_transfer(ext_io_job *j) {
+    size_t done = 0;
+    while (done < j->len) {
+        ssize_t r = j->write ? pwrite(j->fd, (char *)j->buf + done, j->len - done, j->off + (off_t)done)
+                             : pread(j->fd, (char *)j->buf + done, j->len - done, j->off + (off_t)done);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return r < 0 ? errno : EIO;
+        done += (size_t)r;
+    }
+    return 0;
+}
+
+static void *ext_io_main(void *arg) {
+    ext_io_queue *q = arg;
+    pthread_mutex_lock(&q->lock);
+    for (;;) {
+        while (q->head == NULL && !q->stop) pthread_cond_wait(&q->work, &q->lock);
+        if (q->head == NULL) break;
+        ext_io_job *j = q->head;
+        q->head = j->next;
+        if (q->head == NULL) q->tail = NULL;
+        pthread_mutex_unlock(&q->lock);
+        int err = ext_io_transfer(j);
+        pthread_mutex_lock(&q->lock);
+        j->error = err;
+        j->done = 1;
+        pthread_cond_broadcast(&q->done);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+static void ext_io_init(ext_io_queue *q) {
+    memset(q, 0, sizeof(*q));
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->work, NULL);
+    pthread_cond_init(&q->done, NULL);
+    int err = pthread_create(&q->tid, NULL, ext_io_main, q);
+    q->threaded = err == 0;
+    if (!q->threaded) fprintf(stderr, "no I/O thread (%s): reading and writing synchronously\n", strerror(err));
+}
+
+static void ext_io_destroy(ext_io_queue *q) {
+    if (q->threaded) {
+        pthread_mutex_lock(&q->lock);
+        q->stop = 1;
+        pthread_cond_signal(&q->work);
+        pthread_mutex_unlock(&q->lock);
+        pthread_join(q->tid, NULL);
+    }
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->work);
+    pthread_cond_destroy(&q->done);
+}
+
+static void ext_io_post(ext_io_queue *q, ext_io_job *j, int fd, int write, void *buf, size_t len, off_t off) {
+    j->fd = fd;
+    j->write = write;
+    j->buf = buf;
+    j->len = len;
+    j->off = off;
+    j->pending = 1;
+    j->done = 0;
+    j->next = NULL;
+    if (!q->threaded) {
+        double t0 = now_seconds();
+        j->error = ext_io_transfer(j);
+        j->done = 1;
+        q->wait_seconds += now_seconds() - t0;
+        return;
+    }
+    pthread_mutex_lock(&q->lock);
+    if (q->tail) q->tail->next = j;
+    else q->head = j;
+    q->tail = j;
+    pthread_cond_signal(&q->work);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// Waits for a posted job (no-op if none is pending); exits on an I/O error.
+static void ext_io_wait(ext_io_queue *q, ext_io_job *j) {
+    if (!j->pending) return;
+    double t0 = now_seconds();
+    pthread_mutex_lock(&q->lock);
+    while (!j->done) pthread_cond_wait(&q->done, &q->lock);
+    pthread_mutex_unlock(&q->lock);
+    q->wait_seconds += now_seconds() - t0;
+    j->pending = 0;
+    if (j->error) {
+        errno = j->error;
+        die(j->write ? "write" : "read");
+    }
+}
+
+// --- Loser tree ----------------------------------------------------------------
+// tree[1..k-1] hold the loser of the match at each internal node, tree[0] the
+// overall winner. Leaf k is a virtual key below everything, used only while
+// building: every node starts out holding it and each real leaf pushes it up.
+
+#define LT_DONE LLONG_MAX // key of an exhausted run
+
+typedef struct {
+    int k;
+    int *tree;
+    long long *key; // k + 1 keys; key[k] is the virtual -infinity
+} loser_tree;
+
+static void lt_adjust(loser_tree *lt, int s) {
+    for (int t = (s + lt->k) / 2; t > 0; t /= 2) {
+        int other = lt->tree[t];
+        if (lt->key[other] < lt->key[s]) {
+            lt->tree[t] = s;
+            s = other;
+        }
+    }
+    lt->tree[0] = s;
+}
+
+static void lt_build(loser_tree *lt) {
+    lt->key[lt->k] = LLONG_MIN;
+    for (int t = 0; t < lt->k; t++) lt->tree[t] = lt->k;
+    for (int s = lt->k - 1; s >= 0; s--) lt_adjust(lt, s);
+}
+
+// --- Sort state ----------------------------------------------------------------
+
+typedef struct {
+    off_t off;  // byte offset in its file
+    off_t len;  // bytes
+} ext_run;
+
+typedef struct {
+    size_t budget;        // bytes
+    ext_io_queue rd, wr;
+    char *mem;            // the whole budget, carved into buffers per phase
+    double sort_seconds;
+} ext_ctx;
+
+typedef struct {
+    off_t next, end; // unread part of the run
+    int *buf[2];
+    size_t len[2];   // ints in each buffer
+    ext_io_job job[2];
+    int cur;
+    size_t pos;
+} run_reader;
+
+// Starts reading the run's next block into buffer b (or marks b empty)
+static void reader_issue(ext_ctx *x, int fd, run_reader *r, int b, size_t bufsize) {
+    off_t left = r->end - r->next;
+    size_t bytes = left < (off_t)bufsize ? (size_t)left : bufsize;
+    r->len[b] = bytes / sizeof(int);
+    if (bytes == 0) return;
+    ext_io_post(&x->rd, &r->job[b], fd, 0, r->buf[b], bytes, r->next);
+    r->next += (off_t)bytes;
+}
+
+// Makes r->buf[r->cur][r->pos] the next record. Returns 0 when the run is done.
+static int reader_refill(ext_ctx *x, int fd, run_reader *r, size_t bufsize) {
+    int other = r->cur ^ 1;
+    ext_io_wait(&x->rd, &r->job[other]);
+    if (r->len[other] == 0) return 0;
+    reader_issue(x, fd, r, r->cur, bufsize); // read ahead into the buffer just consumed
+    r->cur = other;
+    r->pos = 0;
+    return 1;
+}
+
+typedef struct {
+    int fd;
+    off_t off;
+    int *buf[2];
+    size_t cap, fill; // ints
+    ext_io_job job[2];
+    int cur;
+} run_writer;
+
+static void writer_flush(ext_ctx *x, run_writer *w) {
+    if (w->fill == 0) return;
+    size_t bytes = w->fill * sizeof(int);
+    ext_io_post(&x->wr, &w->job[w->cur], w->fd, 1, w->buf[w->cur], bytes, w->off);
+    w->off += (off_t)bytes;
+    w->cur ^= 1;
+    w->fill = 0;
+    ext_io_wait(&x->wr, &w->job[w->cur]); // the buffer we switch to must be free
+}
+
+// Merges runs[0..k) of src_fd into one run of dst_fd starting at dst_off.
+// Uses 2k + 2 buffers of bufsize bytes from x->mem.
+static void merge_group(ext_ctx *x, int src_fd, const ext_run *runs, int k,
+                        int dst_fd, off_t dst_off, size_t bufsize) {
+    run_reader *rd = calloc((size_t)k, sizeof(run_reader));
+    loser_tree lt = {k, malloc((size_t)k * sizeof(int)), malloc((size_t)(k + 1) * sizeof(long long))};
+    if (rd == NULL || lt.tree == NULL || lt.key == NULL) die("malloc");
+    char *mem = x->mem;
+
+    for (int i = 0; i < k; i++) {
+        run_reader *r = &rd[i];
+        r->next = runs[i].off;
+        r->end = runs[i].off + runs[i].len;
+        for (int b = 0; b < 2; b++, mem += bufsize) r->buf[b] = (int *)mem;
+        reader_issue(x, src_fd, r, 0, bufsize);
+        reader_issue(x, src_fd, r, 1, bufsize);
+    }
+    for (int i = 0; i < k; i++) {
+        run_reader *r = &rd[i];
+        ext_io_wait(&x->rd, &r->job[0]);
+        lt.key[i] = r->len[0] ? r->buf[0][0] : LT_DONE;
+    }
+    lt_build(&lt);
+
+    run_writer w = {dst_fd, dst_off, {(int *)mem, (int *)(mem + bufsize)}, bufsize / sizeof(int), 0, {{0}}, 0};
+    for (;;) {
+        int s = lt.tree[0];
+        if (lt.key[s] == LT_DONE) break;
+        w.buf[w.cur][w.fill++] = (int)lt.key[s];
+        if (w.fill == w.cap) writer_flush(x, &w);
+
+        run_reader *r = &rd[s];
+        if (++r->pos == r->len[r->cur] && !reader_refill(x, src_fd, r, bufsize)) lt.key[s] = LT_DONE;
+        else lt.key[s] = r->buf[r->cur][r->pos];
+        lt_adjust(&lt, s);
+    }
+    writer_flush(x, &w);
+    ext_io_wait(&x->wr, &w.job[0]);
+    ext_io_wait(&x->wr, &w.job[1]);
+
+    free(rd);
+    free(lt.tree);
+    free(lt.key);
+}
+
+static int temp_file(const char *dir) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/extsort.XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0) die(path);
+    unlink(path); // removed with its last descriptor
+    return fd;
+}
+
+// Sorts chunks of the input into runs of run_fd (or straight into out_fd if
+// the input is a single chunk). Returns the number of runs.
+static int generate_runs(ext_ctx *x, int in_fd, off_t total, int run_fd, int out_fd, ext_run **runs_out) {
+    size_t chunk = x->budget / 3 / EXT_ALIGN * EXT_ALIGN;
+    if (chunk / sizeof(int) > INT_MAX) chunk = (size_t)INT_MAX / EXT_ALIGN * EXT_ALIGN;
+    int nruns = (int)((total + (off_t)chunk - 1) / (off_t)chunk);
+    ext_run *runs = malloc((size_t)(nruns > 0 ? nruns : 1) * sizeof(ext_run));
+    if (runs == NULL) die("malloc");
+    int dst_fd = nruns == 1 ? out_fd : run_fd;
+
+    int *buf[3];
+    ext_io_job rjob[3] = {{0}}, wjob[3] = {{0}};
+    for (int b = 0; b < 3; b++) buf[b] = (int *)(x->mem + (size_t)b * chunk);
+    for (int i = 0; i < nruns; i++) {
+        runs[i].off = (off_t)i * (off_t)chunk;
+        runs[i].len = total - runs[i].off < (off_t)chunk ? total - runs[i].off : (off_t)chunk;
+    }
+
+    if (nruns > 0) ext_io_post(&x->rd, &rjob[0], in_fd, 0, buf[0], (size_t)runs[0].len, 0);
+    for (int i = 0; i < nruns; i++) {
+        int b = i % 3, nb = (i + 1) % 3;
+        ext_io_wait(&x->rd, &rjob[b]);
+        if (i + 1 < nruns) {
+            ext_io_wait(&x->wr, &wjob[nb]); // run i - 2 must be on disk before reuse
+            ext_io_post(&x->rd, &rjob[nb], in_fd, 0, buf[nb], (size_t)runs[i + 1].len, runs[i + 1].off);
+        }
+        double t0 = now_seconds();
+        simdSort(buf[b], (int)(runs[i].len / (off_t)sizeof(int)));
+        x->sort_seconds += now_seconds() - t0;
+        ext_io_post(&x->wr, &wjob[b], dst_fd, 1, buf[b], (size_t)runs[i].len, runs[i].off);
+    }
+    for (int b = 0; b < 3; b++) ext_io_wait(&x->wr, &wjob[b]);
+    *runs_out = runs;
+    return nruns;
+}
+
+static int external_sort(const char *in_path, const char *out_path, size_t budget, const char *tmpdir) {
+    int in_fd = open(in_path, O_RDONLY);
+    if (in_fd < 0) die(in_path);
+    struct stat st;
+    if (fstat(in_fd, &st) != 0) die(in_path);
+    off_t total = st.st_size;
+    if (total % (off_t)sizeof(int) != 0) {
+        fprintf(stderr, "%s: size is not a multiple of %zu\n", in_path, sizeof(int));
+        return 1;
+    }
+    posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    int out_fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) die(out_path);
+
+    ext_ctx x = {budget, {0}, {0}, NULL, 0};
+    x.mem = aligned_alloc(EXT_ALIGN, budget / EXT_ALIGN * EXT_ALIGN);
+    if (x.mem == NULL) die("aligned_alloc");
+    ext_io_init(&x.rd);
+    ext_io_init(&x.wr);
+
+    printf("%s: %.1f MB, memory budget %.1f MB, %s kernels\n", in_path, (double)total / 1048576,
+           (double)budget / 1048576, simdsort_impl_name(simdsort_impl()));
+    double t0 = now_seconds();
+    int tmp_fd[2] = {temp_file(tmpdir), -1};
+    int src_fd = tmp_fd[0];
+    ext_run *runs;
+    int nruns = generate_runs(&x, in_fd, total, src_fd, out_fd, &runs);
+    double t1 = now_seconds();
+    printf("  run generation: %d runs in %.2f s (%.0f MB/s), sorting %.2f s, "
+           "blocked on reads %.2f s, on writes %.2f s\n",
+           nruns, t1 - t0, (double)total / 1048576 / (t1 - t0), x.sort_seconds,
+           x.rd.wait_seconds, x.wr.wait_seconds);
+
+    // Widest merge the budget allows with buffers of at least EXT_BUF_MIN
+    int max_fanin = (int)(budget / (2 * EXT_BUF_MIN)) - 1;
+    if (max_fanin < 2) max_fanin = 2;
+    int pass = 0;
+    if (nruns > max_fanin) tmp_fd[1] = temp_file(tmpdir);
+    int dst_fd = tmp_fd[1];
+    while (nruns > 1) {
+        double p0 = now_seconds();
+        x.rd.wait_seconds = x.wr.wait_seconds = 0;
+        int fanin = nruns < max_fanin ? nruns : max_fanin;
+        size_t bufsize = budget / (size_t)(2 * fanin + 2) / EXT_ALIGN * EXT_ALIGN;
+        int ngroups = (nruns + fanin - 1) / fanin;
+        if (ngroups == 1) dst_fd = out_fd;
+        for (int g = 0; g < ngroups; g++) {
+            int first = g * fanin;
+            int k = nruns - first < fanin ? nruns - first : fanin;
+            merge_group(&x, src_fd, runs + first, k, dst_fd, runs[first].off, bufsize);
+            // The merged group keeps the byte range of its inputs
+            off_t len = runs[first + k - 1].off + runs[first + k - 1].len - runs[first].off;
+            runs[g].off = runs[first].off;
+            runs[g].len = len;
+        }
+        double p1 = now_seconds();
+        printf("  merge pass %d: %d runs -> %d, fan-in %d, %zu KB buffers, %.2f s (%.0f MB/s), "
+               "blocked on reads %.2f s, on writes %.2f s\n",
+               ++pass, nruns, ngroups, fanin, bufsize >> 10, p1 - p0, (double)total / 1048576 / (p1 - p0),
+               x.rd.wait_seconds, x.wr.wait_seconds);
+        nruns = ngroups;
+        int t = src_fd; src_fd = dst_fd; dst_fd = t;
+    }
+    if (fsync(out_fd) != 0) die(out_path);
+    printf("  total %.2f s\n", now_seconds() - t0);
+
+    for (int i = 0; i < 2; i++)
+        if (tmp_fd[i] >= 0) close(tmp_fd[i]);
+    ext_io_destroy(&x.rd);
+    ext_io_destroy(&x.wr);
+    free(x.mem);
+    free(runs);
+    close(in_fd);
+    close(out_fd);
+    return 0;
+}
+
+// --- Test data -----------------------------------------------------------------
+
+static int generate_file(const char *path, long long records, uint64_t seed) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) die(path);
+    static int block[1 << 16];
+    for (long long done = 0; done < records;) {
+        int m = records - done < (1 << 16) ? (int)(records - done) : (1 << 16);
+        for (int i = 0; i < m; i++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            block[i] = (int)(seed >> 32);
+        }
+        if (fwrite(block, sizeof(int), (size_t)m, fp) != (size_t)m) die(path);
+        done += m;
+    }
+    fclose(fp);
+    return 0;
+}
+
+static int check_file(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) die(path);
+    static int block[1 << 16];
+    long long pos = 0;
+    int prev = INT_MIN;
+    size_t m;
+    while ((m = fread(block, sizeof(int), 1 << 16, fp)) > 0) {
+        for (size_t i = 0; i < m; i++, pos++) {
+            if (block[i] < prev) {
+                printf("%s: not sorted at record %lld\n", path, pos);
+                fclose(fp);
+                return 1;
+            }
+            prev = block[i];
+        }
+    }
+    fclose(fp);
+    printf("%s: %lld records, sorted\n", path, pos);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 4 && strcmp(argv[1], "-g") == 0)
+        return generate_file(argv[2], strtoll(argv[3], NULL, 10),
+                             argc > 4 ? strtoull(argv[4], NULL, 0) : (uint64_t)time(NULL));
+    if (argc == 3 && strcmp(argv[1], "-c") == 0) return check_file(argv[2]);
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s input output [memory_MB >= 1] [tmpdir]\n"
+                        "       %s -g file records [seed]\n"
+                        "       %s -c file\n", argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    long mb = argc > 3 ? strtol(argv[3], NULL, 10) : 256;
+    if (mb < 1) {
+        fprintf(stderr, "memory_MB must be at least 1\n");
+        return 1;
+    }
+    return external_sort(argv[1], argv[2], (size_t)mb << 20, argc > 4 ? argv[4] : "/tmp");
+}
@@ -0,0 +1,98 @@
+// filecrypt.c
+// Encrypts a file with AES-128-CTR or ChaCha20 through the io_uring pipeline
+// of filecrypt.h and reports the throughput. Both ciphers are stream ciphers,
+// so running the same command on the output decrypts it. The output matches
+//   openssl enc -aes-128-ctr -K key -iv nonce00000000
+//   openssl enc -chacha20    -K key -iv 00000000nonce
+//
+// Build: gcc -O2 -pthread filecrypt.c
+// Usage: ./a.out [options] aes|chacha keyhex noncehex input output
+//   -t threads   encryption workers (default: online CPUs)
+//   -q depth     chunk buffers in flight (default 16)
+//   -s KB        chunk size in KB, a multiple of 4 (default 1024)
+//   -d           O_DIRECT on both files
+//   -p           pread/pwrite instead of io_uring
+// The key is 32 hex digits for AES-128 and 64 for ChaCha20; the nonce is 24.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "filecrypt.h"
+
+// Parses exactly len bytes of hex; returns 0 on success
+static int parse_hex(const char *s, unsigned char *out, size_t len) {
+    if (strlen(s) != 2 * len) return -1;
+    for (size_t i = 0; i < len; i++) {
+        unsigned v;
+        if (sscanf(s + 2 * i, "%2x", &v) != 1) return -1;
+        out[i] = (unsigned char)v;
+    }
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: ./a.out [-t threads] [-q depth] [-s chunk_KB] [-d] [-p] "
+                    "aes|chacha keyhex noncehex input output\n");
+}
+
+int main(int argc, char *argv[]) {
+    fc_opts o;
+    memset(&o, 0, sizeof(o));
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    o.threads = cpus > 0 ? (unsigned)cpus : 1;
+    o.depth = 16;
+    o.chunk = 1024 << 10;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:q:s:dp")) != -1) {
+        switch (opt) {
+        case 't': o.threads = (unsigned)atoi(optarg); break;
+        case 'q': o.depth = (unsigned)atoi(optarg); break;
+        case 's': o.chunk = (size_t)atol(optarg) << 10; break;
+        case 'd': o.direct = 1; break;
+        case 'p': o.no_uring = 1; break;
+        default: usage(); return 1;
+        }
+    }
+    if (argc - optind != 5) {
+        usage();
+        return 1;
+    }
+    const char *cipher = argv[optind];
+    size_t key_len;
+    if (strcmp(cipher, "aes") == 0) {
+        o.cipher = FC_AES128_CTR;
+        key_len = 16;
+    } else if (strcmp(cipher, "chacha") == 0) {
+        o.cipher = FC_CHACHA20;
+        key_len = 32;
+    } else {
+        usage();
+        return 1;
+    }
+    if (parse_hex(argv[optind + 1], o.key, key_len) != 0) {
+        fprintf(stderr, "Key must be %zu hex digits\n", 2 * key_len);
+        return 1;
+    }
+    if (parse_hex(argv[optind + 2], o.nonce, sizeof(o.nonce)) != 0) {
+        fprintf(stderr, "Nonce must be %zu hex digits\n", 2 * sizeof(o.nonce));
+        return 1;
+    }
+
+    fc_stats st;
+    int err = filecrypt(&o, argv[optind + 3], argv[optind + 4], &st);
+    memset(o.key, 0, sizeof(o.key));
+    if (err != 0) {
+        fprintf(stderr, "filecrypt: %s\n", strerror(err));
+        return 1;
+    }
+    printf("%s, %s, %u threads, depth %u, %zu KB chunks%s\n", cipher,
+           st.backend, o.threads, o.depth, o.chunk >> 10, o.direct ? ", O_DIRECT" : "");
+    printf("%llu bytes in %llu chunks, %.3f s, %.2f MB/s\n", (unsigned long long)st.bytes,
+           (unsigned long long)st.chunks, st.seconds,
+           st.seconds > 0 ? (double)st.bytes / st.seconds / 1e6 : 0.0);
+    return 0;
+}
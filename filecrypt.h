@@ -0,0 +1,416 @@
+// filecrypt.h
+// File encryption pipeline: reads a file in fixed-size chunks, encrypts them
+// with a stream cipher (AES-128-CTR or ChaCha20) on a pool of workers and
+// writes them to the output in order.
+//   - I/O goes through io_uring (uring.h). The chunk buffers are registered
+//     with the ring, so reads and writes use READ_FIXED / WRITE_FIXED. There
+//     are 'depth' buffers, which bounds the chunks in flight (being read,
+//     encrypted or written) and the memory used.
+//   - The calling thread is worker 0 of a workpool.h pool and only does I/O:
+//     it keeps every free buffer reading, hands each chunk that finishes to
+//     the pool with wp_spawn, and submits writes in chunk order. Workers
+//     report a finished chunk on an eventfd that the ring keeps a read posted
+//     on, so one io_uring_enter waits for disk and workers alike.
+//   - If io_uring is not available (old kernel, seccomp) or disabled, the
+//     same loop runs on blocking pread/pwrite instead.
+//   - With O_DIRECT, transfers are rounded up to FC_ALIGN and the output is
+//     truncated to the input size at the end.
+// The cipher position of every chunk follows from its file offset (block
+// counter = offset / block size, starting at 0), so chunks can be encrypted
+// in any order and decryption is the same operation. The 32-bit counter
+// limits a file to 64 GiB for AES-CTR and 256 GiB for ChaCha20.
+//
+// Header-only; link with -pthread. O_DIRECT needs _GNU_SOURCE defined before
+// the first #include of the program.
+
+#ifndef FILECRYPT_H
+#define FILECRYPT_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aes.h"
+#include "chacha.h"
+#include "uring.h"
+#include "workpool.h"
+
+#define FC_ALIGN 4096 // buffer alignment and chunk size granularity
+
+enum { FC_AES128_CTR, FC_CHACHA20 };
+
+typedef struct {
+    int cipher;                // FC_AES128_CTR or FC_CHACHA20
+    unsigned char key[32];     // AES-128 uses the first 16 bytes
+    unsigned char nonce[12];
+    size_t chunk;              // bytes per chunk, multiple of FC_ALIGN
+    unsigned depth;            // chunk buffers, i.e. chunks in flight
+    unsigned threads;          // encryption workers
+    int direct;                // open both files with O_DIRECT
+    int no_uring;              // use pread/pwrite even if io_uring works
+} fc_opts;
+
+typedef struct {
+    uint64_t bytes;
+    uint64_t chunks;
+    double seconds;
+    const char *backend;       // "io_uring (fixed buffers)", "io_uring", "pread/pwrite"
+} fc_stats;
+
+enum { FC_FREE, FC_READING, FC_CRYPTING, FC_CRYPTED, FC_WRITING };
+
+typedef struct fc_slot {
+    struct fc_pipe *p;
+    unsigned index;            // buffer index in the registered table
+    int state;
+    unsigned char *buf;
+    uint64_t chunk;
+    size_t len;                // bytes of the file in this chunk
+    size_t done;               // bytes transferred so far by the current read or write
+    struct fc_slot *next;      // on the finished list
+} fc_slot;
+
+typedef struct fc_pipe {
+    const fc_opts *o;
+    int in_fd, out_fd;
+    uint64_t size, nchunks;
+    uint64_t next_read, next_write, written;
+    unsigned char *mem;
+    fc_slot *slots;
+    aes128_ctx aes;
+    chacha20_ctx chacha;
+    wp_group group;
+    long crypting;             // chunks handed to the pool and not collected yet
+    pthread_mutex_t lock;
+    fc_slot *finished;         // encrypted by a worker, not yet seen by the I/O thread
+    int efd;
+    uint64_t efd_count;        // target of the eventfd read
+    int efd_armed;
+    uring ring;
+    int use_uring, fixed;
+    unsigned inflight;         // reads and writes submitted to the ring
+    int error;                 // first errno
+} fc_pipe;
+
+// user_data of a completion: slot index << 2 | operation
+enum { FC_OP_READ = 1, FC_OP_WRITE = 2, FC_OP_EVENT = 3 };
+
+// --- Encryption --------------------------------------------------------------
+
+static inline void fcCryptTask(void *arg) {
+    fc_slot *s = arg;
+    fc_pipe *p = s->p;
+    uint64_t off = s->chunk * p->o->chunk;
+    if (p->o->cipher == FC_AES128_CTR) {
+        aes128_ctx c = p->aes;
+        aes128_ctr_start(&c, p->o->nonce, (uint32_t)(off / 16));
+        aes128_ctr(&c, s->buf, s->buf, s->len);
+    } else {
+        chacha20_ctx c = p->chacha;
+        c.state[12] = (uint32_t)(off / 64);
+        chacha20_xor(&c, s->buf, s->buf, s->len);
+    }
+    pthread_mutex_lock(&p->lock);
+    s->next = p->finished;
+    p->finished = s;
+    pthread_mutex_unlock(&p->lock);
+    uint64_t one = 1;
+    if (write(p->efd, &one, sizeof(one)) < 0) {} // cannot fail short of overflowing 2^64
+}
+
+// Marks the chunks the workers finished as ready to write.
+static inline void fcCollect(fc_pipe *p) {
+    pthread_mutex_lock(&p->lock);
+    fc_slot *s = p->finished;
+    p->finished = NULL;
+    pthread_mutex_unlock(&p->lock);
+    for (; s; s = s->next) {
+        s->state = FC_CRYPTED;
+        p->crypting--;
+    }
+}
+
+// Slot holding chunk c if it is ready to write
+static inline fc_slot *fcReady(fc_pipe *p, uint64_t c) {
+    for (unsigned i = 0; i < p->o->depth; i++)
+        if (p->slots[i].state == FC_CRYPTED && p->slots[i].chunk == c) return &p->slots[i];
+    return NULL;
+}
+
+static inline fc_slot *fcFree(fc_pipe *p) {
+    for (unsigned i = 0; i < p->o->depth; i++)
+        if (p->slots[i].state == FC_FREE) return &p->slots[i];
+    return NULL;
+}
+
+static inline void fcFail(fc_pipe *p, int err) {
+    if (p->error == 0) p->error = err;
+}
+
+// Bytes the next transfer of s asks for; O_DIRECT needs whole blocks (the
+// buffer has room, and the final read stops at end of file by itself)
+static inline size_t fcRemaining(const fc_pipe *p, const fc_slot *s) {
+    size_t n = s->len - s->done;
+    if (p->o->direct) n = (n + FC_ALIGN - 1) & ~(size_t)(FC_ALIGN - 1);
+    return n;
+}
+
+static inline void fcStartChunk(fc_pipe *p, fc_slot *s) {
+    s->chunk = p->next_read++;
+    uint64_t off = s->chunk * p->o->chunk;
+    s->len = p->size - off < p->o->chunk ? (size_t)(p->size - off) : p->o->chunk;
+    s->done = 0;
+    if (p->o->direct && s->len % FC_ALIGN) // the padding of the last chunk is written out
+        memset(s->buf + s->len, 0, FC_ALIGN - s->len % FC_ALIGN);
+}
+
+// A read of s finished with res bytes (or -errno); returns 1 when the chunk is complete
+static inline int fcReadDone(fc_pipe *p, fc_slot *s, long res) {
+    if (res < 0) {
+        fcFail(p, (int)-res);
+        return 0;
+    }
+    if (res == 0) { // the file shrank under us
+        fcFail(p, EIO);
+        return 0;
+    }
+    s->done += (size_t)res;
+    if (s->done < s->len) return 0;
+    s->done = 0;
+    s->state = FC_CRYPTING;
+    p->crypting++;
+    wp_spawn(&p->group, fcCryptTask, s);
+    return 1;
+}
+
+static inline int fcWriteDone(fc_pipe *p, fc_slot *s, long res) {
+    if (res <= 0) {
+        fcFail(p, res < 0 ? (int)-res : EIO);
+        return 0;
+    }
+    s->done += (size_t)res;
+    if (s->done < s->len) return 0;
+    s->state = FC_FREE;
+    p->written++;
+    return 1;
+}
+
+// --- io_uring backend --------------------------------------------------------
+
+static inline void fcSubmit(fc_pipe *p, fc_slot *s, int op) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&p->ring); // never full: depth + 1 entries at most
+    int is_write = op == FC_OP_WRITE;
+    int code = p->fixed ? (is_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED)
+                        : (is_write ? IORING_OP_WRITE : IORING_OP_READ);
+    uring_prep(sqe, code, is_write ? p->out_fd : p->in_fd, s->buf + s->done, (unsigned)fcRemaining(p, s),
+               s->chunk * p->o->chunk + s->done, (uint64_t)s->index << 2 | (unsigned)op);
+    if (p->fixed) sqe->buf_index = (uint16_t)s->index;
+    p->inflight++;
+}
+
+static inline void fcArmEvent(fc_pipe *p) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&p->ring);
+    uring_prep(sqe, IORING_OP_READ, p->efd, &p->efd_count, sizeof(p->efd_count), 0, FC_OP_EVENT);
+    p->efd_armed = 1;
+}
+
+static inline void fcUringLoop(fc_pipe *p) {
+    fcArmEvent(p);
+    while (p->inflight > 0 || p->crypting > 0 || (p->error == 0 && p->written < p->nchunks)) {
+        fcCollect(p);
+        if (p->error == 0) {
+            fc_slot *s;
+            while (p->next_write < p->nchunks && (s = fcReady(p, p->next_write)) != NULL) {
+                s->state = FC_WRITING;
+                p->next_write++;
+                fcSubmit(p, s, FC_OP_WRITE);
+            }
+            while (p->next_read < p->nchunks && (s = fcFree(p)) != NULL) {
+                fcStartChunk(p, s);
+                s->state = FC_READING;
+                fcSubmit(p, s, FC_OP_READ);
+            }
+        }
+        // Workers that finish while we sleep complete the eventfd read; if
+        // that read failed, wait for them here instead
+        if (!p->efd_armed && p->crypting > 0) {
+            wp_sync(&p->group);
+            continue;
+        }
+        int err = uring_enter(&p->ring, p->inflight > 0 || p->efd_armed);
+        if (err < 0) { // nothing in flight can be trusted to complete; give up on the ring
+            fcFail(p, -err);
+            wp_sync(&p->group);
+            return;
+        }
+        struct io_uring_cqe cqe;
+        while (uring_next_cqe(&p->ring, &cqe)) {
+            unsigned op = (unsigned)(cqe.user_data & 3);
+            if (op == FC_OP_EVENT) {
+                p->efd_armed = 0;
+                if (cqe.res < 0 && cqe.res != -EINTR && cqe.res != -EAGAIN) fcFail(p, -cqe.res);
+                else if (p->error == 0) fcArmEvent(p);
+                continue;
+            }
+            fc_slot *s = &p->slots[cqe.user_data >> 2];
+            p->inflight--;
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                if (p->error == 0) fcSubmit(p, s, (int)op);
+                continue;
+            }
+            if (op == FC_OP_READ ? fcReadDone(p, s, cqe.res) : fcWriteDone(p, s, cqe.res)) continue;
+            if (p->error == 0) fcSubmit(p, s, (int)op); // short transfer: the rest
+        }
+    }
+    // Complete the posted eventfd read so the kernel no longer holds efd_count
+    if (p->efd_armed) {
+        uint64_t one = 1;
+        if (write(p->efd, &one, sizeof(one)) < 0) {}
+        struct io_uring_cqe cqe;
+        while (p->efd_armed && uring_enter(&p->ring, 1) == 0)
+            while (uring_next_cqe(&p->ring, &cqe))
+                if ((cqe.user_data & 3) == FC_OP_EVENT) p->efd_armed = 0;
+    }
+}
+
+// --- pread/pwrite backend ----------------------------------------------------
+
+static inline long fcTransfer(fc_pipe *p, fc_slot *s, int is_write) {
+    for (;;) {
+        off_t off = (off_t)(s->chunk * p->o->chunk + s->done);
+        ssize_t n = is_write ? pwrite(p->out_fd, s->buf + s->done, fcRemaining(p, s), off)
+                          : pread(p->in_fd, s->buf + s->done, fcRemaining(p, s), off);
+        if (n >= 0 || errno != EINTR) return n < 0 ? -errno : (long)n;
+    }
+}
+
+static inline void fcSyncLoop(fc_pipe *p) {
+    while (p->crypting > 0 || (p->error == 0 && p->written < p->nchunks)) {
+        fcCollect(p);
+        fc_slot *s;
+        if (p->error == 0 && (s = fcReady(p, p->next_write)) != NULL) {
+            p->next_write++;
+            s->state = FC_WRITING;
+            while (!fcWriteDone(p, s, fcTransfer(p, s, 1)) && p->error == 0) {}
+        } else if (p->error == 0 && p->next_read < p->nchunks && (s = fcFree(p)) != NULL) {
+            fcStartChunk(p, s);
+            s->state = FC_READING;
+            while (!fcReadDone(p, s, fcTransfer(p, s, 0)) && p->error == 0) {}
+        } else if (p->crypting > 0) {
+            uint64_t n; // wait for a worker
+            if (read(p->efd, &n, sizeof(n)) < 0 && errno != EINTR) fcFail(p, errno);
+        }
+    }
+}
+
+static inline void fcIoMain(void *arg) {
+    fc_pipe *p = arg;
+    if (p->use_uring) fcUringLoop(p);
+    else fcSyncLoop(p);
+    wp_sync(&p->group);
+}
+
+// --- Entry point -------------------------------------------------------------
+
+// Encrypts (or decrypts) in_path into out_path. Returns 0, or an errno value.
+static inline int filecrypt(const fc_opts *o, const char *in_path, const char *out_path, fc_stats *st) {
+    if (o->chunk == 0 || o->chunk % FC_ALIGN || o->chunk > (1u << 30) || o->depth == 0 || o->depth > 4096)
+        return EINVAL;
+    memset(st, 0, sizeof(*st));
+    fc_pipe p;
+    memset(&p, 0, sizeof(p));
+    p.o = o;
+    p.efd = -1;
+    p.out_fd = -1;
+    int flags = o->direct ? O_DIRECT : 0;
+    p.in_fd = open(in_path, O_RDONLY | flags);
+    if (p.in_fd < 0) return errno;
+    int err = 0;
+    struct stat sb;
+    if (fstat(p.in_fd, &sb) != 0) {
+        err = errno;
+        goto out;
+    }
+    p.size = (uint64_t)sb.st_size;
+    if (p.size > (o->cipher == FC_AES128_CTR ? 16ull : 64ull) << 32) {
+        err = EFBIG;
+        goto out;
+    }
+    p.nchunks = (p.size + o->chunk - 1) / o->chunk;
+    p.out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC | flags, 0644);
+    if (p.out_fd < 0) {
+        err = errno;
+        goto out;
+    }
+    p.efd = eventfd(0, EFD_CLOEXEC);
+    p.mem = aligned_alloc(FC_ALIGN, (size_t)o->depth * o->chunk);
+    p.slots = calloc(o->depth, sizeof(fc_slot));
+    if (p.efd < 0 || p.mem == NULL || p.slots == NULL) {
+        err = p.efd < 0 ? errno : ENOMEM;
+        goto out;
+    }
+    for (unsigned i = 0; i < o->depth; i++) {
+        p.slots[i].p = &p;
+        p.slots[i].index = i;
+        p.slots[i].buf = p.mem + (size_t)i * o->chunk;
+    }
+    if (o->cipher == FC_AES128_CTR) aes128_init(&p.aes, o->key);
+    else chacha20_init(&p.chacha, o->key, o->nonce, 0);
+    pthread_mutex_init(&p.lock, NULL);
+
+    st->backend = "pread/pwrite";
+    if (!o->no_uring && uring_init(&p.ring, 2 * o->depth + 2) == 0) {
+        p.use_uring = 1;
+        st->backend = "io_uring";
+        struct iovec *iov = malloc(o->depth * sizeof(*iov));
+        if (iov) {
+            for (unsigned i = 0; i < o->depth; i++) {
+                iov[i].iov_base = p.slots[i].buf;
+                iov[i].iov_len = o->chunk;
+            }
+            if (uring_register_buffers(&p.ring, iov, o->depth) == 0) {
+                p.fixed = 1;
+                st->backend = "io_uring (fixed buffers)";
+            }
+            free(iov);
+        }
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    wp_pool pool;
+    if (wp_init(&pool, o->threads + 1) != 0) {
+        err = ENOMEM;
+    } else {
+        wp_run(&pool, fcIoMain, &p);
+        wp_destroy(&pool);
+        err = p.error;
+    }
+    // O_DIRECT wrote the last chunk padded to a whole block
+    if (err == 0 && o->direct && ftruncate(p.out_fd, (off_t)p.size) != 0) err = errno;
+    if (err == 0 && close(p.out_fd) != 0) err = errno;
+    p.out_fd = -1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    st->seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    st->bytes = p.size;
+    st->chunks = p.nchunks;
+
+    if (p.use_uring) uring_destroy(&p.ring);
+    pthread_mutex_destroy(&p.lock);
+out:
+    free(p.slots);
+    free(p.mem);
+    if (p.efd >= 0) close(p.efd);
+    if (p.out_fd >= 0) close(p.out_fd);
+    close(p.in_fd);
+    return err;
+}
+
+#endif // FILECRYPT_H
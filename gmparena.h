@@ -0,0 +1,375 @@
+// gmparena.h
+// Pooled allocator for GMP, installed with mp_set_memory_functions, so that
+// the mpz temporaries of the prime searches and RSA code stop going through
+// malloc.
+//   - Blocks come in power-of-two size classes from 32 bytes to 32 KB (a 16
+//     byte header included). Each thread keeps a free list per class and
+//     refills an empty list from slabs of at least 64 KB; freed blocks go to
+//     the freeing thread's list. Larger blocks go straight to the system.
+//   - A thread's free lists move to a shared depot when it exits, and other
+//     threads refill from the depot before mapping new slabs.
+//   - Secure mode, for key material: slabs and large blocks are mlock'd (kept
+//     out of swap) and excluded from core dumps, and every block is zeroed
+//     when it is freed or moved by a realloc. If mlock fails (RLIMIT_MEMLOCK)
+//     a warning is printed once and the memory stays pageable.
+//   - Off mode passes every call to malloc/realloc/free, only counting them,
+//     for a before/after comparison.
+// Every call is counted per thread. Totals include the calling thread and
+// the threads that have exited, so read them after joining the workers.
+//
+// gmp_arena_install must run before the first GMP allocation (blocks GMP got
+// from malloc would be handed to the arena's free), and gmp_arena_release
+// after the last mpz is cleared. Environment:
+//   GMP_ARENA=off|pool|secure  - overrides the mode a program installs
+
+#ifndef GMPARENA_H
+#define GMPARENA_H
+
+#include <gmp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+enum { GMP_ARENA_OFF, GMP_ARENA_POOL, GMP_ARENA_SECURE };
+
+#define GMP_ARENA_MIN_SHIFT 5   // smallest class: 32 bytes
+#define GMP_ARENA_CLASSES 11    // up to 32 KB
+#define GMP_ARENA_SLAB (64 << 10)
+#define GMP_ARENA_HEADER 16     // keeps the payload 16-byte aligned
+#define GMP_ARENA_LARGE 0xffffu // class of a block served by the system
+
+typedef struct {
+    uint64_t allocs, reallocs, frees; // calls from GMP
+    uint64_t system;                  // of those, served by malloc or mmap
+    uint64_t slab_bytes;              // mapped for the size classes
+    uint64_t locked_bytes;            // mlock'd (secure mode), slabs and large blocks
+} gmp_arena_counts;
+
+// Header in front of every block; the free-list link overlays it
+typedef union gmpArenaHeader {
+    struct {
+        size_t size;  // bytes requested; for secure large blocks, the mapping minus the header
+        unsigned cls; // size class or GMP_ARENA_LARGE
+    } h;
+    union gmpArenaHeader *next;
+    unsigned char pad[GMP_ARENA_HEADER];
+} gmpArenaHeader;
+
+typedef struct gmpArenaSlab {
+    struct gmpArenaSlab *next;
+    void *mem;
+    size_t len;
+} gmpArenaSlab;
+
+typedef struct {
+    gmpArenaHeader *free[GMP_ARENA_CLASSES];
+    gmp_arena_counts n;
+    int registered; // has the thread-exit hook (gmpArenaSelf)
+} gmpArenaThread;
+
+static int gmp_arena_mode = GMP_ARENA_OFF;
+static _Thread_local gmpArenaThread gmp_arena_local;
+static pthread_mutex_t gmp_arena_lock = PTHREAD_MUTEX_INITIALIZER;
+static gmpArenaHeader *gmp_arena_depot[GMP_ARENA_CLASSES]; // under gmp_arena_lock
+static gmpArenaSlab *gmp_arena_slabs;                      // under gmp_arena_lock
+static gmp_arena_counts gmp_arena_exited;                  // under gmp_arena_lock
+static pthread_key_t gmp_arena_key;
+static pthread_once_t gmp_arena_once = PTHREAD_ONCE_INIT;
+static int gmp_arena_warned;
+
+static inline void gmpArenaAddCounts(gmp_arena_counts *dst, const gmp_arena_counts *src) {
+    dst->allocs += src->allocs;
+    dst->reallocs += src->reallocs;
+    dst->frees += src->frees;
+    dst->system += src->system;
+    dst->slab_bytes += src->slab_bytes;
+    dst->locked_bytes += src->locked_bytes;
+}
+
+// Thread exit: hand the free lists to the depot and keep the counts
+static inline void gmpArenaThreadExit(void *arg) {
+    gmpArenaThread *t = arg;
+    pthread_mutex_lock(&gmp_arena_lock);
+    for (int c = 0; c < GMP_ARENA_CLASSES; c++) {
+        gmpArenaHeader *b = t->free[c];
+        while (b) {
+            gmpArenaHeader *next = b->next;
+            b->next = gmp_arena_depot[c];
+            gmp_arena_depot[c] = b;
+            b = next;
+        }
+        t->free[c] = NULL;
+    }
+    gmpArenaAddCounts(&gmp_arena_exited, &t->n);
+    memset(&t->n, 0, sizeof(t->n));
+    pthread_mutex_unlock(&gmp_arena_lock);
+}
+
+static inline void gmpArenaMakeKey(void) {
+    pthread_key_create(&gmp_arena_key, gmpArenaThreadExit);
+}
+
+// The calling thread's state, with the exit hook set on first use
+static inline gmpArenaThread *gmpArenaSelf(void) {
+    gmpArenaThread *t = &gmp_arena_local;
+    if (__builtin_expect(!t->registered, 0)) {
+        pthread_once(&gmp_arena_once, gmpArenaMakeKey);
+        pthread_setspecific(gmp_arena_key, t);
+        t->registered = 1;
+    }
+    return t;
+}
+
+static inline int gmpArenaClass(size_t size) {
+    size_t need = size + GMP_ARENA_HEADER;
+    if (need <= (size_t)1 << GMP_ARENA_MIN_SHIFT) return 0;
+    int c = 64 - __builtin_clzll((unsigned long long)(need - 1)) - GMP_ARENA_MIN_SHIFT;
+    return c < GMP_ARENA_CLASSES ? c : -1;
+}
+
+static inline size_t gmpArenaClassBytes(int c) {
+    return (size_t)1 << (c + GMP_ARENA_MIN_SHIFT);
+}
+
+// Anonymous mapping, locked and kept out of core dumps in secure mode
+static inline void *gmpArenaMap(size_t len) {
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+    if (gmp_arena_mode == GMP_ARENA_SECURE) {
+        madvise(p, len, MADV_DONTDUMP);
+        if (mlock(p, len) == 0) {
+            gmp_arena_local.n.locked_bytes += len;
+        } else if (!__atomic_exchange_n(&gmp_arena_warned, 1, __ATOMIC_RELAXED)) {
+            fprintf(stderr, "gmparena: mlock failed, key material may be swapped (raise RLIMIT_MEMLOCK)\n");
+        }
+    }
+    return p;
+}
+
+static inline void gmpArenaUnmap(void *p, size_t len) {
+    if (gmp_arena_mode == GMP_ARENA_SECURE) {
+        explicit_bzero(p, len);
+        munlock(p, len);
+    }
+    munmap(p, len);
+}
+
+// Refills the free list of class c from the depot, or else from a new slab.
+// Returns 0, or -1 if out of memory.
+static inline int gmpArenaRefill(int c) {
+    gmpArenaThread *t = &gmp_arena_local;
+    size_t bytes = gmpArenaClassBytes(c);
+    size_t len = bytes * 4 > GMP_ARENA_SLAB ? bytes * 4 : GMP_ARENA_SLAB;
+    // At most a slab's worth, so that threads starting together share the depot
+    pthread_mutex_lock(&gmp_arena_lock);
+    if (gmp_arena_depot[c]) {
+        gmpArenaHeader *b = gmp_arena_depot[c];
+        for (size_t k = 0; b && k < len / bytes; k++) {
+            gmp_arena_depot[c] = b->next;
+            b->next = t->free[c];
+            t->free[c] = b;
+            b = gmp_arena_depot[c];
+        }
+        pthread_mutex_unlock(&gmp_arena_lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&gmp_arena_lock);
+
+    gmpArenaSlab *s = malloc(sizeof(*s));
+    unsigned char *mem = s ? gmpArenaMap(len) : NULL;
+    if (mem == NULL) {
+        free(s);
+        return -1;
+    }
+    s->mem = mem;
+    s->len = len;
+    pthread_mutex_lock(&gmp_arena_lock);
+    s->next = gmp_arena_slabs;
+    gmp_arena_slabs = s;
+    pthread_mutex_unlock(&gmp_arena_lock);
+    for (size_t off = len; off >= bytes; off -= bytes) {
+        gmpArenaHeader *b = (gmpArenaHeader *)(mem + off - bytes);
+        b->next = t->free[c];
+        t->free[c] = b;
+    }
+    t->n.system++;
+    t->n.slab_bytes += len;
+    return 0;
+}
+
+// --- GMP memory functions ----------------------------------------------------
+
+static inline void *gmpArenaOutOfMemory(size_t size) {
+    fprintf(stderr, "gmparena: out of memory allocating %zu bytes\n", size);
+    abort(); // GMP has no way to report a failed allocation
+}
+
+static inline void *gmpArenaGet(size_t size) {
+    gmpArenaThread *t = &gmp_arena_local;
+    int c = gmpArenaClass(size);
+    gmpArenaHeader *b;
+    if (c < 0) {
+        size_t len = size + GMP_ARENA_HEADER;
+        if (gmp_arena_mode == GMP_ARENA_SECURE) {
+            len = (len + 4095) & ~(size_t)4095;
+            b = gmpArenaMap(len);
+        } else {
+            b = malloc(len);
+        }
+        if (b == NULL) return gmpArenaOutOfMemory(size);
+        t->n.system++;
+        b->h.size = len - GMP_ARENA_HEADER;
+        b->h.cls = GMP_ARENA_LARGE;
+        return b + 1;
+    }
+    if (t->free[c] == NULL && gmpArenaRefill(c) != 0) return gmpArenaOutOfMemory(size);
+    b = t->free[c];
+    t->free[c] = b->next;
+    b->h.size = size;
+    b->h.cls = (unsigned)c;
+    return b + 1;
+}
+
+static inline void *gmpArenaAlloc(size_t size) {
+    gmpArenaSelf()->n.allocs++;
+    return gmpArenaGet(size);
+}
+
+static inline void gmpArenaRelease(gmpArenaHeader *b) {
+    gmpArenaThread *t = &gmp_arena_local;
+    if (b->h.cls == GMP_ARENA_LARGE) {
+        if (gmp_arena_mode == GMP_ARENA_SECURE) {
+            size_t len = b->h.size + GMP_ARENA_HEADER;
+            t->n.locked_bytes -= len; // not exact if its mlock failed; only a report
+            gmpArenaUnmap(b, len);
+        } else {
+            free(b);
+        }
+        return;
+    }
+    int c = (int)b->h.cls;
+    if (gmp_arena_mode == GMP_ARENA_SECURE) explicit_bzero(b + 1, gmpArenaClassBytes(c) - GMP_ARENA_HEADER);
+    b->next = t->free[c];
+    t->free[c] = b;
+}
+
+static inline void gmpArenaFree(void *ptr, size_t size) {
+    (void)size; // the header knows
+    gmpArenaSelf()->n.frees++;
+    if (ptr) gmpArenaRelease((gmpArenaHeader *)ptr - 1);
+}
+
+static inline void *gmpArenaRealloc(void *ptr, size_t old_size, size_t new_size) {
+    (void)old_size;
+    gmpArenaThread *t = gmpArenaSelf();
+    t->n.reallocs++;
+    gmpArenaHeader *b = (gmpArenaHeader *)ptr - 1;
+    int c = gmpArenaClass(new_size);
+    if (c >= 0 && (unsigned)c == b->h.cls) { // still fits its block
+        b->h.size = new_size;
+        return ptr;
+    }
+    if (c < 0 && b->h.cls == GMP_ARENA_LARGE) {
+        if (gmp_arena_mode == GMP_ARENA_SECURE) {
+            if (new_size <= b->h.size) return ptr; // within the mapping
+        } else { // malloc may grow it in place
+            gmpArenaHeader *nb = realloc(b, new_size + GMP_ARENA_HEADER);
+            if (nb == NULL) return gmpArenaOutOfMemory(new_size);
+            t->n.system++;
+            nb->h.size = new_size;
+            return nb + 1;
+        }
+    }
+    void *q = gmpArenaGet(new_size);
+    memcpy(q, ptr, b->h.size < new_size ? b->h.size : new_size);
+    gmpArenaRelease(b);
+    return q;
+}
+
+// Off mode: the system allocator, counted
+static inline void *gmpArenaSysAlloc(size_t size) {
+    gmpArenaThread *t = gmpArenaSelf();
+    t->n.allocs++;
+    t->n.system++;
+    void *p = malloc(size);
+    return p ? p : gmpArenaOutOfMemory(size);
+}
+
+static inline void *gmpArenaSysRealloc(void *ptr, size_t old_size, size_t new_size) {
+    (void)old_size;
+    gmpArenaThread *t = gmpArenaSelf();
+    t->n.reallocs++;
+    t->n.system++;
+    void *p = realloc(ptr, new_size);
+    return p ? p : gmpArenaOutOfMemory(new_size);
+}
+
+static inline void gmpArenaSysFree(void *ptr, size_t size) {
+    (void)size;
+    gmpArenaSelf()->n.frees++;
+    free(ptr);
+}
+
+// --- Public API --------------------------------------------------------------
+
+static inline const char *gmp_arena_mode_name(int mode) {
+    return mode == GMP_ARENA_SECURE ? "secure" : mode == GMP_ARENA_POOL ? "pool" : "off";
+}
+
+// Installs the allocator in 'mode', unless GMP_ARENA names another. Returns
+// the mode in effect.
+static inline int gmp_arena_install(int mode) {
+    const char *env = getenv("GMP_ARENA");
+    if (env) {
+        if (strcmp(env, "off") == 0) mode = GMP_ARENA_OFF;
+        else if (strcmp(env, "pool") == 0) mode = GMP_ARENA_POOL;
+        else if (strcmp(env, "secure") == 0) mode = GMP_ARENA_SECURE;
+        else fprintf(stderr, "GMP_ARENA: unknown mode %s, using %s\n", env, gmp_arena_mode_name(mode));
+    }
+    gmp_arena_mode = mode;
+    if (mode == GMP_ARENA_OFF) mp_set_memory_functions(gmpArenaSysAlloc, gmpArenaSysRealloc, gmpArenaSysFree);
+    else mp_set_memory_functions(gmpArenaAlloc, gmpArenaRealloc, gmpArenaFree);
+    return mode;
+}
+
+static inline void gmp_arena_stats(gmp_arena_counts *out) {
+    pthread_mutex_lock(&gmp_arena_lock);
+    *out = gmp_arena_exited;
+    pthread_mutex_unlock(&gmp_arena_lock);
+    gmpArenaAddCounts(out, &gmp_arena_local.n);
+}
+
+// One line of counts, e.g. at the end of a run
+static inline void gmp_arena_report(FILE *fp) {
+    gmp_arena_counts n;
+    gmp_arena_stats(&n);
+    fprintf(fp, "GMP allocator (%s): %llu allocs, %llu reallocs, %llu frees, %llu from the system",
+            gmp_arena_mode_name(gmp_arena_mode), (unsigned long long)n.allocs,
+            (unsigned long long)n.reallocs, (unsigned long long)n.frees, (unsigned long long)n.system);
+    if (gmp_arena_mode != GMP_ARENA_OFF) fprintf(fp, ", %llu KB in slabs", (unsigned long long)(n.slab_bytes >> 10));
+    if (gmp_arena_mode == GMP_ARENA_SECURE) fprintf(fp, ", %llu KB locked", (unsigned long long)(n.locked_bytes >> 10));
+    fprintf(fp, "\n");
+}
+
+// Restores GMP's default allocator and returns the slabs to the system
+// (zeroed first in secure mode). Every mpz, mpq, random state and string from
+// GMP must have been freed, and the other threads joined.
+static inline void gmp_arena_release(void) {
+    mp_set_memory_functions(NULL, NULL, NULL);
+    if (gmp_arena_mode == GMP_ARENA_OFF) return;
+    pthread_mutex_lock(&gmp_arena_lock);
+    while (gmp_arena_slabs) {
+        gmpArenaSlab *s = gmp_arena_slabs;
+        gmp_arena_slabs = s->next;
+        gmpArenaUnmap(s->mem, s->len);
+        free(s);
+    }
+    memset(gmp_arena_depot, 0, sizeof(gmp_arena_depot));
+    pthread_mutex_unlock(&gmp_arena_lock);
+    memset(gmp_arena_local.free, 0, sizeof(gmp_arena_local.free));
+}
+
+#endif // GMPARENA_H
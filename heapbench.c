@@ -0,0 +1,144 @@
+// heapbench.c
+// Binary heapSort against the 4- and 8-ary Floyd heap sorts (all sorting.h),
+// and the dheap priority queue (dheap.h) at arity 2, 4 and 8.
+//   Sort: n = 10^3 .. max_n uniform random keys. Comparisons and key moves
+//   come from the counted sorts (heapSort counts swaps, three moves each; the
+//   Floyd sorts count single moves); times are the median of the NoCount
+//   instantiations over the trials.
+//   Queue: the hold model of event schedulers. A queue of m items (m = 10^3
+//   .. max_n) is repeatedly popped and re-pushed with the popped key plus a
+//   random increment; reported as nanoseconds per pop+push pair.
+// Results go to heapsort_bench.csv and heap_pq_bench.csv.
+//
+// Build: gcc -O2 heapbench.c
+// Usage: ./a.out [max_n] [seed]   (default 10^7)
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "benchutil.h"
+#include "dheap.h"
+#include "sorting.h"
+
+#define SORT_TRIALS 5
+#define PQ_OPS 2000000
+
+static uint64_t rng_next(uint64_t *s) {
+    *s = *s * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *s >> 32;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    const char *name;
+    int arity;
+    void (*counted)(int arr[], int n);
+    void (*timed)(int arr[], int n);
+} heap_variant;
+
+static const heap_variant variants[] = {
+    {"HeapSort", 2, heapSort, heapSortNoCount},
+    {"HeapSort4", 4, heapSort4, heapSort4NoCount},
+    {"HeapSort8", 8, heapSort8, heapSort8NoCount},
+};
+
+// Seconds per pop+push pair over PQ_OPS operations on m items, or a negative
+// value if the queue returned keys out of order
+static double pq_hold(int arity, long m, uint64_t seed) {
+    dheap h;
+    dheap_item it = {0, 0};
+    if (dheap_init(&h, arity, (size_t)m) != 0) return -1;
+    uint64_t s = seed;
+    for (long i = 0; i < m; i++) dheap_push(&h, (int)(rng_next(&s) >> 20), (int)i);
+    double t0 = now_seconds();
+    for (long op = 0; op < PQ_OPS; op++) {
+        dheap_pop(&h, &it);
+        dheap_push(&h, it.key + (int)(rng_next(&s) >> 20), it.value);
+    }
+    double secs = now_seconds() - t0;
+    // Drain: keys must come out in order
+    int last = INT_MIN;
+    while (dheap_pop(&h, &it)) {
+        if (it.key < last) secs = -1;
+        last = it.key;
+    }
+    dheap_destroy(&h);
+    return secs / PQ_OPS;
+}
+
+int main(int argc, char **argv) {
+    long max_n = argc > 1 ? strtol(argv[1], NULL, 10) : 10000000L;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 0) : (uint64_t)time(NULL);
+    if (max_n < 1000 || max_n > 1000000000L) {
+        fprintf(stderr, "usage: %s [max_n in 10^3..10^9] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *fs = fopen("heapsort_bench.csv", "w");
+    FILE *fq = fopen("heap_pq_bench.csv", "w");
+    int *input = malloc((size_t)max_n * sizeof(int));
+    int *arr = malloc((size_t)max_n * sizeof(int));
+    if (fs == NULL || fq == NULL || input == NULL || arr == NULL) {
+        printf("Error opening file!\n");
+        return 1;
+    }
+    fprintf(fs, "Algorithm,Arity,ArraySize,Comparisons,Swaps,Seconds\n");
+    fprintf(fq, "Arity,QueueSize,NsPerHold\n");
+
+    printf("seed = 0x%llx\n", (unsigned long long)seed);
+    for (long n = 1000; n <= max_n; n *= 10) {
+        uint64_t s = seed ^ (uint64_t)n;
+        for (long i = 0; i < n; i++) input[i] = (int)rng_next(&s);
+        for (int v = 0; v < 3; v++) {
+            const heap_variant *hv = &variants[v];
+            memcpy(arr, input, (size_t)n * sizeof(int));
+            comparisons = 0; swaps = 0;
+            hv->counted(arr, (int)n);
+            if (!is_sorted(arr, (int)n)) {
+                fprintf(stderr, "%s produced unsorted output (n = %ld)\n", hv->name, n);
+                return 1;
+            }
+            double secs[SORT_TRIALS];
+            for (int t = 0; t < SORT_TRIALS; t++) {
+                memcpy(arr, input, (size_t)n * sizeof(int));
+                double t0 = now_seconds();
+                hv->timed(arr, (int)n);
+                secs[t] = now_seconds() - t0;
+            }
+            qsort(secs, SORT_TRIALS, sizeof(double), cmp_double);
+            printf("n = %-9ld %-10s %14llu comparisons %14llu swaps %9.4f s\n",
+                   n, hv->name, comparisons, swaps, secs[SORT_TRIALS / 2]);
+            fprintf(fs, "%s,%d,%ld,%llu,%llu,%.6f\n", hv->name, hv->arity, n,
+                    comparisons, swaps, secs[SORT_TRIALS / 2]);
+        }
+    }
+
+    for (long m = 1000; m <= max_n; m *= 10) {
+        printf("queue of %-9ld", m);
+        for (int arity = 2; arity <= 8; arity *= 2) {
+            double ns = pq_hold(arity, m, seed) * 1e9;
+            if (ns < 0) {
+                fprintf(stderr, "%d-ary queue returned keys out of order\n", arity);
+                return 1;
+            }
+            printf("  %d-ary %6.1f ns/hold", arity, ns);
+            fprintf(fq, "%d,%ld,%.2f\n", arity, m, ns);
+        }
+        printf("\n");
+    }
+
+    free(input);
+    free(arr);
+    fclose(fs);
+    fclose(fq);
+    printf("Data written to heapsort_bench.csv and heap_pq_bench.csv\n");
+    return 0;
+}
@@ -1,56 +1,6 @@
 #include <stdio.h>
 
-// Function to merge two halves of an array
-void merge(int arr[], int left, int mid, int right) {
-    int i, j, k;
-    int n1 = mid - left + 1;  // Size of left subarray
-    int n2 = right - mid;     // Size of right subarray
-
-    // Create temp arrays
-    int L[n1], R[n2];
-
-    // Copy data to temp arrays L[] and R[]
-    for (i = 0; i < n1; i++)
-        L[i] = arr[left + i];
-    for (j = 0; j < n2; j++)
-        R[j] = arr[mid + 1 + j];
-
-    // Merge the temp arrays back into arr[left..right]
-    i = 0; // Initial index of left subarray
-    j = 0; // Initial index of right subarray
-    k = left; // Initial index of merged array
-
-    while (i < n1 && j < n2) {
-        if (L[i] <= R[j]) {
-            arr[k++] = L[i++];
-        } else {
-            arr[k++] = R[j++];
-        }
-    }
-
-    // Copy the remaining elements of L[], if any
-    while (i < n1)
-        arr[k++] = L[i++];
-
-    // Copy the remaining elements of R[], if any
-    while (j < n2)
-        arr[k++] = R[j++];
-}
-
-// Recursive merge sort function
-void mergeSort(int arr[], int left, int right) {
-    if (left < right) {
-        // Same as (left + right) / 2 but avoids overflow
-        int mid = left + (right - left) / 2;
-
-        // Sort first and second halves
-        mergeSort(arr, left, mid);
-        mergeSort(arr, mid + 1, right);
-
-        // Merge the sorted halves
-        merge(arr, left, mid, right);
-    }
-}
+#include "sorting.h" // bottomUpMergeSort: one auxiliary buffer, no VLAs
 
 // Function to print an array
 void printArray(int arr[], int size) {
@@ -67,7 +17,7 @@ int main() {
     printf("Original array: ");
     printArray(arr, n);
 
-    mergeSort(arr, 0, n - 1);
+    bottomUpMergeSort(arr, n, NULL);
 
     printf("Sorted array:   ");
     printArray(arr, n);
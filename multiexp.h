@@ -0,0 +1,386 @@
+// multiexp.h
+// Multi-lane modular exponentiation: up to MEXP_LANES independent bases raised
+// to one shared exponent under one shared modulus, as needed by multi-round
+// Miller-Rabin / Solovay-Strassen (the exponent d or (n-1)/2 depends only on n).
+//
+// Numbers are held lane-sliced: limb j of every lane sits in one vector, so a
+// Montgomery multiplication advances all lanes at once. Because the exponent is
+// shared, the window index is the same in every lane and no gathers are needed.
+//   - AVX-512 IFMA: 8 lanes, 52-bit limbs, VPMADD52LUQ / VPMADD52HUQ
+//   - AVX2:         4 lanes (two passes per 8 bases), 28-bit limbs, VPMULUDQ
+//   - scalar:       mpz_powm per lane
+// Kernels use almost-Montgomery multiplication (outputs < 2n, R >= 4n) and are
+// compiled with target attributes, so no -m flags are needed to build.
+//
+// The kernel is picked once per process by cpudispatch.h. Auto-detection
+// prefers IFMA and otherwise falls back to scalar: with only 32x32-bit
+// multipliers the AVX2 kernel measured slower than GMP's assembly mpz_powm, so
+// it is used only when requested with MEXP_IMPL=avx2 (MEXP_IMPL=ifma / scalar
+// force the other paths). A vector kernel must pass a Fermat test on the
+// Mersenne prime 2^521 - 1 and agree with mpz_powm before it is used.
+
+#ifndef MULTIEXP_H
+#define MULTIEXP_H
+
+#include <gmp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "cpudispatch.h"
+#include "primality.h"
+
+#define MEXP_LANES 8
+#define MEXP_WINDOW 4                 // fixed window; 16 table entries
+
+typedef enum {
+    MEXP_IMPL_SCALAR,
+    MEXP_IMPL_AVX2,
+    MEXP_IMPL_IFMA
+} mexp_impl_t;
+
+typedef struct {
+    mexp_impl_t impl;
+    int radix;                        // limb width in bits (52 or 28)
+    int vl;                           // lanes per vector (8 or 4)
+    int L;                            // limbs per number
+    int cap_L;
+    mpz_t n, e, tmp;
+    mpz_t y[MEXP_LANES];              // per-lane results, preallocated
+    mpz_t a[MEXP_LANES];              // per-lane bases, scratch for callers
+    uint64_t k0[MEXP_LANES];          // -n^-1 mod 2^radix, one per lane
+    uint64_t *nv;                     // n, limb j broadcast to all lanes   [L * vl]
+    uint64_t *one;                    // R mod n, broadcast                 [L * vl]
+    uint64_t *unit;                   // plain 1, broadcast                 [L * vl]
+    uint64_t *tab;                    // window table                       [16 * L * vl]
+    uint64_t *x;                      // accumulator                        [L * vl]
+    uint64_t *t;                      // product scratch                    [(2L + 2) * vl]
+} mexp_ctx;
+
+static inline const char *mexp_impl_name(mexp_impl_t impl) {
+    return impl == MEXP_IMPL_IFMA ? "avx512-ifma" : impl == MEXP_IMPL_AVX2 ? "avx2" : "scalar";
+}
+
+// --- Lane-sliced almost-Montgomery multiplication ------------------------------
+// r = a * b * R^-1 (mod n) with r < 2n for a, b < 2n; R = 2^(radix * L).
+// a, b, r are [L * vl] lane-sliced arrays of normalized limbs; r may alias a or b.
+// n (nv) is lane-sliced and k0 holds one value per lane, so the lanes may use
+// different moduli of up to L limbs (RSA.c verifies one key per lane).
+
+__attribute__((target("avx512f,avx512ifma")))
+static void mexp_amm_ifma(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                          const uint64_t *nv, const uint64_t *k0, int L, uint64_t *tbuf) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i mask = _mm512_set1_epi64((1ULL << 52) - 1);
+    const __m512i vk0 = _mm512_loadu_si512(k0);
+    const __m512i *A = (const __m512i *)a, *B = (const __m512i *)b, *NV = (const __m512i *)nv;
+    __m512i *t = (__m512i *)tbuf, *R = (__m512i *)r;
+
+    for (int j = 0; j < 2 * L + 1; j++) t[j] = zero;
+    for (int i = 0; i < L; i++) {
+        __m512i bi = B[i];
+        for (int j = 0; j < L; j++) {
+            t[i + j] = _mm512_madd52lo_epu64(t[i + j], A[j], bi);
+            t[i + j + 1] = _mm512_madd52hi_epu64(t[i + j + 1], A[j], bi);
+        }
+        __m512i m = _mm512_and_si512(_mm512_madd52lo_epu64(zero, t[i], vk0), mask);
+        for (int j = 0; j < L; j++) {
+            t[i + j] = _mm512_madd52lo_epu64(t[i + j], NV[j], m);
+            t[i + j + 1] = _mm512_madd52hi_epu64(t[i + j + 1], NV[j], m);
+        }
+        t[i + 1] = _mm512_add_epi64(t[i + 1], _mm512_srli_epi64(t[i], 52));
+    }
+    for (int j = L; j < 2 * L; j++) {
+        t[j + 1] = _mm512_add_epi64(t[j + 1], _mm512_srli_epi64(t[j], 52));
+        R[j - L] = _mm512_and_si512(t[j], mask);
+    }
+}
+
+// Column sums of 28x28-bit products are flushed every 32 iterations so the
+// 64-bit accumulators cannot overflow at any modulus size.
+__attribute__((target("avx2")))
+static void mexp_amm_avx2(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                          const uint64_t *nv, const uint64_t *k0, int L, uint64_t *tbuf) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i mask = _mm256_set1_epi64x((1LL << 28) - 1);
+    const __m256i vk0 = _mm256_loadu_si256((const __m256i *)k0);
+    const __m256i *A = (const __m256i *)a, *B = (const __m256i *)b, *NV = (const __m256i *)nv;
+    __m256i *t = (__m256i *)tbuf, *R = (__m256i *)r;
+
+    for (int j = 0; j < 2 * L + 1; j++) t[j] = zero;
+    for (int i = 0; i < L; i++) {
+        __m256i bi = B[i];
+        for (int j = 0; j < L; j++) {
+            t[i + j] = _mm256_add_epi64(t[i + j], _mm256_mul_epu32(A[j], bi));
+        }
+        __m256i m = _mm256_and_si256(_mm256_mul_epu32(t[i], vk0), mask);
+        for (int j = 0; j < L; j++) {
+            t[i + j] = _mm256_add_epi64(t[i + j], _mm256_mul_epu32(NV[j], m));
+        }
+        t[i + 1] = _mm256_add_epi64(t[i + 1], _mm256_srli_epi64(t[i], 28));
+        if ((i & 31) == 31) {
+            for (int j = i + 1; j < i + L + 1; j++) {
+                t[j + 1] = _mm256_add_epi64(t[j + 1], _mm256_srli_epi64(t[j], 28));
+                t[j] = _mm256_and_si256(t[j], mask);
+            }
+        }
+    }
+    for (int j = L; j < 2 * L; j++) {
+        t[j + 1] = _mm256_add_epi64(t[j + 1], _mm256_srli_epi64(t[j], 28));
+        R[j - L] = _mm256_and_si256(t[j], mask);
+    }
+}
+
+static inline void mexp_amm(mexp_ctx *ctx, uint64_t *r, const uint64_t *a, const uint64_t *b) {
+    if (ctx->impl == MEXP_IMPL_IFMA) mexp_amm_ifma(r, a, b, ctx->nv, ctx->k0, ctx->L, ctx->t);
+    else mexp_amm_avx2(r, a, b, ctx->nv, ctx->k0, ctx->L, ctx->t);
+}
+
+// --- Radix conversion ------------------------------------------------------------
+
+// dst[j * stride] = bits [j*radix, (j+1)*radix) of z, for j < L.
+static inline void mexp_to_radix(uint64_t *dst, size_t stride, const mpz_t z, int radix, int L) {
+    const mp_limb_t *zp = mpz_limbs_read(z);
+    size_t zn = mpz_size(z);
+    uint64_t mask = (1ULL << radix) - 1;
+    for (int j = 0; j < L; j++) {
+        size_t bit = (size_t)j * radix, w = bit / 64, off = bit % 64;
+        uint64_t v = w < zn ? zp[w] >> off : 0;
+        if (off + radix > 64 && w + 1 < zn) v |= zp[w + 1] << (64 - off);
+        dst[j * stride] = v & mask;
+    }
+}
+
+static inline void mexp_from_radix(mpz_t z, const uint64_t *src, size_t stride, int radix, int L) {
+    mp_size_t limbs = (mp_size_t)(((size_t)L * radix + 63) / 64 + 1);
+    mp_limb_t *zp = mpz_limbs_write(z, limbs);
+    for (mp_size_t i = 0; i < limbs; i++) zp[i] = 0;
+    for (int j = 0; j < L; j++) {
+        size_t bit = (size_t)j * radix, w = bit / 64, off = bit % 64;
+        uint64_t v = src[j * stride];
+        zp[w] |= v << off;
+        if (off + radix > 64) zp[w + 1] |= v >> (64 - off);
+    }
+    mpz_limbs_finish(z, limbs);
+}
+
+// --- Context -------------------------------------------------------------------
+
+static inline void mexp_alloc(mexp_ctx *ctx, int cap_L) {
+    size_t words = (size_t)(20 * cap_L + 2 * cap_L + 2) * MEXP_LANES;
+    uint64_t *buf = aligned_alloc(64, (words * sizeof(uint64_t) + 63) / 64 * 64);
+    size_t stride = (size_t)cap_L * MEXP_LANES;
+    ctx->cap_L = cap_L;
+    ctx->nv = buf;
+    ctx->one = ctx->nv + stride;
+    ctx->unit = ctx->one + stride;
+    ctx->x = ctx->unit + stride;
+    ctx->tab = ctx->x + stride;                       // 16 * stride
+    ctx->t = ctx->tab + 16 * stride;                  // (2L + 2) * MEXP_LANES
+}
+
+static inline void mexpInitImpl(mexp_ctx *ctx, size_t max_bits, mexp_impl_t impl) {
+    ctx->impl = impl;
+    mp_bitcnt_t zbits = (mp_bitcnt_t)(2 * max_bits + 128);
+    mpz_init2(ctx->n, zbits);
+    mpz_init2(ctx->e, zbits);
+    mpz_init2(ctx->tmp, 2 * zbits);
+    for (int l = 0; l < MEXP_LANES; l++) {
+        mpz_init2(ctx->y[l], 2 * zbits);
+        mpz_init2(ctx->a[l], zbits);
+    }
+    ctx->L = 0;
+    mexp_alloc(ctx, (int)((max_bits + 2 + 27) / 28));   // enough limbs for either radix
+}
+
+static inline void mexp_clear(mexp_ctx *ctx) {
+    mpz_clears(ctx->n, ctx->e, ctx->tmp, NULL);
+    for (int l = 0; l < MEXP_LANES; l++) mpz_clears(ctx->y[l], ctx->a[l], NULL);
+    free(ctx->nv);
+}
+
+// Bind the context to an odd modulus n > 3 and an exponent e >= 1.
+static inline void mexp_set(mexp_ctx *ctx, const mpz_t n, const mpz_t e) {
+    mpz_set(ctx->n, n);
+    mpz_set(ctx->e, e);
+    if (ctx->impl == MEXP_IMPL_SCALAR) return;
+
+    ctx->radix = ctx->impl == MEXP_IMPL_IFMA ? 52 : 28;
+    ctx->vl = ctx->impl == MEXP_IMPL_IFMA ? 8 : 4;
+    ctx->L = (int)((mpz_sizeinbase(n, 2) + 2 + ctx->radix - 1) / ctx->radix);   // R >= 4n
+    if (ctx->L > ctx->cap_L) {
+        free(ctx->nv);
+        mexp_alloc(ctx, ctx->L);
+    }
+
+    uint64_t mask = (1ULL << ctx->radix) - 1;
+    uint64_t n0 = mpz_getlimbn(n, 0), inv = n0;
+    for (int i = 0; i < 5; i++) inv *= 2 - n0 * inv;
+    for (int l = 0; l < MEXP_LANES; l++) ctx->k0[l] = (0 - inv) & mask;
+
+    mpz_set_ui(ctx->tmp, 0);
+    mpz_setbit(ctx->tmp, (mp_bitcnt_t)ctx->radix * ctx->L);
+    mpz_mod(ctx->tmp, ctx->tmp, n);                    // R mod n
+    for (int l = 0; l < ctx->vl; l++) {
+        mexp_to_radix(ctx->nv + l, ctx->vl, n, ctx->radix, ctx->L);
+        mexp_to_radix(ctx->one + l, ctx->vl, ctx->tmp, ctx->radix, ctx->L);
+        for (int j = 0; j < ctx->L; j++) ctx->unit[j * ctx->vl + l] = j == 0;
+    }
+}
+
+// One vector pass over 'count' <= vl lanes starting at bases[0].
+static inline void mexp_pass(mexp_ctx *ctx, mpz_t *out, const mpz_t *bases, int count) {
+    int L = ctx->L, vl = ctx->vl;
+    size_t stride = (size_t)L * vl;
+    uint64_t *tab = ctx->tab;
+
+    memcpy(tab, ctx->one, stride * sizeof(uint64_t));
+    for (int l = 0; l < vl; l++) {
+        if (l < count) {                                 // mont(a) = a * R mod n
+            mpz_mul_2exp(ctx->tmp, bases[l], (mp_bitcnt_t)ctx->radix * L);
+            mpz_mod(ctx->tmp, ctx->tmp, ctx->n);
+            mexp_to_radix(tab + stride + l, vl, ctx->tmp, ctx->radix, L);
+        } else {                                         // idle lane: base 1
+            for (int j = 0; j < L; j++) tab[stride + j * vl + l] = ctx->one[j * vl + l];
+        }
+    }
+    for (int k = 2; k < (1 << MEXP_WINDOW); k++) {
+        mexp_amm(ctx, tab + k * stride, tab + (k - 1) * stride, tab + stride);
+    }
+
+    const mp_limb_t *ep = mpz_limbs_read(ctx->e);
+    long windows = (long)((mpz_sizeinbase(ctx->e, 2) + MEXP_WINDOW - 1) / MEXP_WINDOW);
+    for (long w = windows - 1; w >= 0; w--) {
+        size_t bit = (size_t)w * MEXP_WINDOW;
+        unsigned nib = (unsigned)(ep[bit / GMP_NUMB_BITS] >> (bit % GMP_NUMB_BITS)) & ((1u << MEXP_WINDOW) - 1);
+        if (w == windows - 1) {
+            memcpy(ctx->x, tab + nib * stride, stride * sizeof(uint64_t));
+            continue;
+        }
+        for (int k = 0; k < MEXP_WINDOW; k++) mexp_amm(ctx, ctx->x, ctx->x, ctx->x);
+        if (nib) mexp_amm(ctx, ctx->x, ctx->x, tab + nib * stride);
+    }
+    mexp_amm(ctx, ctx->x, ctx->x, ctx->unit);            // leave Montgomery form: <= n
+
+    for (int l = 0; l < count; l++) {
+        mexp_from_radix(out[l], ctx->x + l, vl, ctx->radix, L);
+        if (mpz_cmp(out[l], ctx->n) >= 0) mpz_sub(out[l], out[l], ctx->n);
+    }
+}
+
+// ctx->y[l] = bases[l]^e mod n for l < count <= MEXP_LANES, with 0 <= bases[l] < n.
+static inline void mexp_powm(mexp_ctx *ctx, const mpz_t *bases, int count) {
+    if (ctx->impl == MEXP_IMPL_SCALAR) {
+        for (int l = 0; l < count; l++) mpz_powm(ctx->y[l], bases[l], ctx->e, ctx->n);
+        return;
+    }
+    for (int off = 0; off < count; off += ctx->vl) {
+        int c = count - off < ctx->vl ? count - off : ctx->vl;
+        mexp_pass(ctx, ctx->y + off, bases + off, c);
+    }
+}
+
+// --- Dispatch ----------------------------------------------------------------
+
+typedef struct {
+    cpu_impl impl;
+    mexp_impl_t kind;
+} mexp_kernel;
+
+static const mexp_kernel mexp_kernels[] = {
+    {{"ifma", CPU_AVX512F | CPU_AVX512IFMA, 0}, MEXP_IMPL_IFMA},
+    {{"avx2", CPU_AVX2, CPU_IMPL_MANUAL}, MEXP_IMPL_AVX2},
+    {{"scalar", 0, 0}, MEXP_IMPL_SCALAR},
+};
+
+// With p = 2^521 - 1 prime, b^(p-1) = 1 for the bases 2..11 (two passes of
+// the AVX2 kernel), and b^65537 must match mpz_powm
+static inline int mexpKernelSelfTest(int i) {
+    mexp_ctx ctx;
+    mpz_t p, e, want;
+    mpz_t bases[10];
+    int ok = 1;
+    mexpInitImpl(&ctx, 521, mexp_kernels[i].kind);
+    mpz_inits(p, e, want, NULL);
+    mpz_ui_pow_ui(p, 2, 521);
+    mpz_sub_ui(p, p, 1);
+    for (int l = 0; l < 10; l++) mpz_init_set_ui(bases[l], (unsigned long)l + 2);
+
+    mpz_sub_ui(e, p, 1);
+    mexp_set(&ctx, p, e);
+    mexp_powm(&ctx, bases, 10);
+    for (int l = 0; l < 10; l++) ok &= mpz_cmp_ui(ctx.y[l], 1) == 0;
+
+    mpz_set_ui(e, 65537);
+    for (int l = 0; l < 10; l++) mpz_mul_2exp(bases[l], bases[l], 500 - 17 * l);
+    mexp_set(&ctx, p, e);
+    mexp_powm(&ctx, bases, 10);
+    for (int l = 0; l < 10; l++) {
+        mpz_powm(want, bases[l], e, p);
+        ok &= mpz_cmp(ctx.y[l], want) == 0;
+        mpz_clear(bases[l]);
+    }
+    mpz_clears(p, e, want, NULL);
+    mexp_clear(&ctx);
+    return ok;
+}
+
+// Detected once per process; the race on first use is benign (same answer).
+static int mexp_impl_cached = -1;
+
+static inline mexp_impl_t mexp_detect(void) {
+    int k = __atomic_load_n(&mexp_impl_cached, __ATOMIC_RELAXED);
+    if (k < 0) {
+        k = CPU_SELECT("MEXP_IMPL", mexp_kernels, mexpKernelSelfTest);
+        __atomic_store_n(&mexp_impl_cached, k, __ATOMIC_RELAXED);
+    }
+    return mexp_kernels[k].kind;
+}
+
+// Prepare a context for moduli of up to max_bits bits with the best kernel
+// this CPU supports.
+static inline void mexp_init(mexp_ctx *ctx, size_t max_bits) {
+    mexpInitImpl(ctx, max_bits, mexp_detect());
+}
+
+// --- Multi-round primality tests ------------------------------------------------
+// Both take a prime_ctx already bound to n and a mexp_ctx bound to (n, d) or
+// (n, (n-1)/2) respectively, and return how many of the 'count' rounds said
+// "probably prime"; pass[l] (optional) receives each round's verdict.
+
+static inline int mexp_mr_rounds(prime_ctx *pc, mexp_ctx *mc, const mpz_t *bases, int count, int *pass) {
+    int passed = 0;
+    mexp_powm(mc, bases, count);
+    for (int l = 0; l < count; l++) {
+        mpz_ptr y = mc->y[l];
+        int ok = mpz_cmp_ui(y, 1) == 0 || mpz_cmp(y, pc->n_minus_1) == 0;
+        for (unsigned r = 1; r < pc->s && !ok; r++) {
+            mpz_mul(y, y, y);
+            mpz_mod(y, y, pc->n);
+            if (mpz_cmp(y, pc->n_minus_1) == 0) ok = 1;
+        }
+        if (pass) pass[l] = ok;
+        passed += ok;
+    }
+    return passed;
+}
+
+static inline int mexp_ss_rounds(prime_ctx *pc, mexp_ctx *mc, const mpz_t *bases, int count, int *pass) {
+    int passed = 0;
+    mexp_powm(mc, bases, count);
+    for (int l = 0; l < count; l++) {
+        int ok = 0;
+        mpz_gcd(pc->g, bases[l], pc->n);
+        if (mpz_cmp_ui(pc->g, 1) == 0) {
+            int jac = mpz_jacobi(bases[l], pc->n);
+            if (jac == 1) ok = mpz_cmp_ui(mc->y[l], 1) == 0;
+            else if (jac == -1) ok = mpz_cmp(mc->y[l], pc->n_minus_1) == 0;
+        }
+        if (pass) pass[l] = ok;
+        passed += ok;
+    }
+    return passed;
+}
+
+#endif // MULTIEXP_H
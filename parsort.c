@@ -0,0 +1,99 @@
+// parsort.c
+// Thread-scaling benchmark for the parallel sorts in parsort.h.
+// For n = 10^6, 10^7, ... up to max_n, sorts the same uniform random array
+// with the sequential introsort and with parallelMergeSort/parallelSampleSort
+// on 1, 2, 4, ... max_threads workers, checks the output, and reports wall
+// time and speedup over the single-worker run. One input, one work array and
+// one scratch buffer are allocated per size and reused by every run.
+//
+// Build: gcc -O2 -pthread parsort.c
+// Usage: ./a.out [max_n] [max_threads]   (default 10^8 and all online CPUs;
+//        10^9 needs about 12 GB)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "benchutil.h"
+#include "parsort.h"
+
+typedef int (*par_sort_fn)(wp_pool *pool, int arr[], int n, int tmp[]);
+
+int main(int argc, char **argv) {
+    long max_n = argc > 1 ? strtol(argv[1], NULL, 10) : 100000000L;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned max_threads = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 10) : (unsigned)(ncpu > 0 ? ncpu : 1);
+    if (max_n < 1000000L || max_n > 2000000000L || max_threads == 0) {
+        fprintf(stderr, "usage: %s [max_n in 10^6..2*10^9] [max_threads]\n", argv[0]);
+        return 1;
+    }
+
+    static const char *names[] = {"ParallelMergeSort", "ParallelSampleSort"};
+    static const par_sort_fn sorts[] = {parallelMergeSort, parallelSampleSort};
+
+    FILE *fp = fopen("parsort_scaling.csv", "w");
+    if (fp == NULL) {
+        printf("Error opening file!\n");
+        return 1;
+    }
+    fprintf(fp, "Algorithm,ArraySize,Threads,Seconds,Speedup\n");
+
+    srand(12345);
+    for (long n = 1000000L; n <= max_n; n *= 10) {
+        int *input = malloc((size_t)n * sizeof(int));
+        int *arr = malloc((size_t)n * sizeof(int));
+        int *tmp = malloc((size_t)n * sizeof(int));
+        if (input == NULL || arr == NULL || tmp == NULL) {
+            fprintf(stderr, "out of memory at n = %ld\n", n);
+            return 1;
+        }
+        for (long i = 0; i < n; i++) input[i] = rand();
+
+        memcpy(arr, input, (size_t)n * sizeof(int));
+        double t0 = now_seconds();
+        introSortNoCount(arr, 0, (int)n - 1);
+        double seq = now_seconds() - t0;
+        printf("\nn = %ld: sequential introSort %.3f s\n", n, seq);
+        fprintf(fp, "IntroSort,%ld,1,%.6f,1.00\n", n, seq);
+
+        for (int a = 0; a < 2; a++) {
+            double base = 0;
+            for (unsigned t = 1;; t = t * 2 < max_threads ? t * 2 : max_threads) {
+                wp_pool pool;
+                if (wp_init(&pool, t) != 0) {
+                    fprintf(stderr, "could not start %u worker threads\n", t);
+                    return 1;
+                }
+                memcpy(arr, input, (size_t)n * sizeof(int));
+                t0 = now_seconds();
+                int rc = sorts[a](&pool, arr, (int)n, tmp);
+                double secs = now_seconds() - t0;
+                wp_destroy(&pool);
+                if (rc != 0) {
+                    fprintf(stderr, "%s: out of memory (n = %ld)\n", names[a], n);
+                    return 1;
+                }
+                if (!is_sorted(arr, (int)n)) {
+                    fprintf(stderr, "%s produced unsorted output (n = %ld, %u threads)\n",
+                            names[a], n, t);
+                    return 1;
+                }
+                if (t == 1) base = secs;
+                printf("  %-19s %3u threads  %8.3f s  speedup %5.2f\n",
+                       names[a], t, secs, base / secs);
+                fprintf(fp, "%s,%ld,%u,%.6f,%.2f\n", names[a], n, t, secs, base / secs);
+                if (t == max_threads) break;
+            }
+        }
+
+        free(input);
+        free(arr);
+        free(tmp);
+    }
+
+    fclose(fp);
+    printf("Data written to parsort_scaling.csv\n");
+    return 0;
+}
@@ -0,0 +1,283 @@
+// parsort.h
+// Parallel sorting entry points on the work-stealing pool (workpool.h):
+//   parallelMergeSort  - task-parallel merge sort; halves are sorted as
+//                        spawned tasks and merged by a parallel merge that
+//                        splits the output by binary-search co-ranking.
+//   parallelSampleSort - sample sort for very large inputs: splitters from an
+//                        oversampled sorted sample, parallel bucket counting and
+//                        scatter, then every bucket sorted as its own task.
+// Below the grain sizes the sequential kernels of sorting.h take over, in their
+// uncounted (NoCount) instantiation: these sorts are measured by wall time,
+// and per-thread counts of a task-parallel sort would not add up to anything.
+
+#ifndef PARSORT_H
+#define PARSORT_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sorting.h"
+#include "workpool.h"
+
+#define PAR_SORT_GRAIN   (1 << 16) // ranges at most this long are sorted sequentially
+#define PAR_MERGE_GRAIN  (1 << 15) // merges at most this long run sequentially
+#define SAMPLE_OVERSAMPLE 64       // samples per bucket
+#define SAMPLE_MAX_BUCKETS 1024
+
+// --- Parallel merge ----------------------------------------------------------
+
+typedef struct {
+    const int *a;
+    const int *b;
+    int na, nb;
+    int *dst;
+} ps_merge_args;
+
+// Number of elements of a among the first k outputs of a stable merge of a
+// and b (ties taken from a).
+static inline int coRank(const int *a, int na, const int *b, int nb, int k) {
+    int lo = k > nb ? k - nb : 0;
+    int hi = k < na ? k : na;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (a[mid] <= b[k - mid - 1]) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static inline void mergeTwo(const int *a, int na, const int *b, int nb, int *dst) {
+    int i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (a[i] <= b[j]) dst[k++] = a[i++];
+        else dst[k++] = b[j++];
+    }
+    while (i < na) dst[k++] = a[i++];
+    while (j < nb) dst[k++] = b[j++];
+}
+
+static void parallelMergeTask(void *p) {
+    ps_merge_args *m = p;
+    if (m->na + m->nb <= PAR_MERGE_GRAIN) {
+        mergeTwo(m->a, m->na, m->b, m->nb, m->dst);
+        return;
+    }
+    int k = (m->na + m->nb) / 2;
+    int i = coRank(m->a, m->na, m->b, m->nb, k);
+    ps_merge_args left = {m->a, m->b, i, k - i, m->dst};
+    ps_merge_args right = {m->a + i, m->b + (k - i), m->na - i, m->nb - (k - i), m->dst + k};
+    wp_group g = {0};
+    wp_spawn(&g, parallelMergeTask, &left);
+    parallelMergeTask(&right);
+    wp_sync(&g);
+}
+
+// --- Parallel merge sort -----------------------------------------------------
+
+typedef struct {
+    int *a;
+    int *tmp;
+    int n;
+    int to_tmp; // leave the sorted result in tmp instead of a
+} ps_sort_args;
+
+static void parallelMergeSortTask(void *p) {
+    ps_sort_args *s = p;
+    if (s->n <= PAR_SORT_GRAIN) {
+        introSortNoCount(s->a, 0, s->n - 1);
+        if (s->to_tmp) memcpy(s->tmp, s->a, (size_t)s->n * sizeof(int));
+        return;
+    }
+    // Sort both halves into the other buffer, then merge back into ours
+    int h = s->n / 2;
+    ps_sort_args left = {s->a, s->tmp, h, !s->to_tmp};
+    ps_sort_args right = {s->a + h, s->tmp + h, s->n - h, !s->to_tmp};
+    wp_group g = {0};
+    wp_spawn(&g, parallelMergeSortTask, &left);
+    parallelMergeSortTask(&right);
+    wp_sync(&g);
+
+    const int *src = s->to_tmp ? s->a : s->tmp;
+    ps_merge_args m = {src, src + h, h, s->n - h, s->to_tmp ? s->tmp : s->a};
+    parallelMergeTask(&m);
+}
+
+// Sorts arr[0..n-1] on 'pool'. tmp must hold n ints, or be NULL to allocate
+// one buffer for the call. Returns 0, or -1 if the buffer could not be allocated.
+static inline int parallelMergeSort(wp_pool *pool, int arr[], int n, int tmp[]) {
+    int *own = NULL;
+    if (n < 2) return 0;
+    if (tmp == NULL) {
+        own = malloc((size_t)n * sizeof(int));
+        if (own == NULL) return -1;
+        tmp = own;
+    }
+    ps_sort_args root = {arr, tmp, n, 0};
+    wp_run(pool, parallelMergeSortTask, &root);
+    free(own);
+    return 0;
+}
+
+// --- Sample sort -------------------------------------------------------------
+
+typedef struct {
+    int *arr, *tmp;
+    int n;
+    int nbuckets, nblocks;
+    int *splitters;  // nbuckets - 1 ascending keys
+    long *offsets;   // [block][bucket] write positions (counts before the prefix sum)
+    long *bucket_start; // nbuckets + 1 bucket boundaries in tmp
+    int *sample;     // nbuckets * SAMPLE_OVERSAMPLE keys
+    struct ps_sample_args *args; // one per block or bucket, whichever is more
+} ps_sample_ctx;
+
+typedef struct ps_sample_args {
+    ps_sample_ctx *c;
+    int index; // block or bucket
+} ps_sample_args;
+
+// Bucket of x: the number of splitters below x (branch-free lower bound).
+// A key equal to a repeated splitter goes to the bucket between the two equal
+// splitters, which then holds only that key and needs no sorting.
+static inline int sampleBucket(const int *splitters, int nsplit, int x) {
+    const int *base = splitters;
+    int len = nsplit;
+    while (len > 1) {
+        int half = len / 2;
+        base = base[half - 1] < x ? base + half : base;
+        len -= half;
+    }
+    int b = (int)(base - splitters) + (len == 1 && *base < x);
+    if (b + 1 < nsplit && splitters[b + 1] == x) b++;
+    return b;
+}
+
+static inline void sampleBlockRange(const ps_sample_ctx *c, int blk, int *lo, int *hi) {
+    *lo = (int)((long)c->n * blk / c->nblocks);
+    *hi = (int)((long)c->n * (blk + 1) / c->nblocks);
+}
+
+static void sampleCountTask(void *p) {
+    ps_sample_args *a = p;
+    ps_sample_ctx *c = a->c;
+    long *cnt = c->offsets + (size_t)a->index * c->nbuckets;
+    int lo, hi;
+    sampleBlockRange(c, a->index, &lo, &hi);
+    for (int i = lo; i < hi; i++) cnt[sampleBucket(c->splitters, c->nbuckets - 1, c->arr[i])]++;
+}
+
+static void sampleScatterTask(void *p) {
+    ps_sample_args *a = p;
+    ps_sample_ctx *c = a->c;
+    long *off = c->offsets + (size_t)a->index * c->nbuckets;
+    int lo, hi;
+    sampleBlockRange(c, a->index, &lo, &hi);
+    for (int i = lo; i < hi; i++) {
+        int x = c->arr[i];
+        c->tmp[off[sampleBucket(c->splitters, c->nbuckets - 1, x)]++] = x;
+    }
+}
+
+static void sampleBucketTask(void *p) {
+    ps_sample_args *a = p;
+    ps_sample_ctx *c = a->c;
+    long lo = c->bucket_start[a->index], hi = c->bucket_start[a->index + 1];
+    int n = (int)(hi - lo);
+    if (n > 1) {
+        // A bucket bounded by two equal splitters holds a single key (sampleBucket)
+        int equal = a->index > 0 && a->index < c->nbuckets - 1 &&
+                    c->splitters[a->index - 1] == c->splitters[a->index];
+        if (!equal) introSortNoCount(c->tmp + lo, 0, n - 1);
+    }
+    memcpy(c->arr + lo, c->tmp + lo, (size_t)n * sizeof(int));
+}
+
+static void parallelSampleSortTask(void *p) {
+    ps_sample_ctx *c = p;
+    int nb = c->nbuckets, nblk = c->nblocks;
+    ps_sample_args *args = c->args;
+    wp_group g = {0};
+
+    // Splitters: every SAMPLE_OVERSAMPLE-th key of a sorted pseudo-random sample
+    int nsample = nb * SAMPLE_OVERSAMPLE;
+    int *sample = c->sample;
+    unsigned long long r = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < nsample; i++) {
+        r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+        sample[i] = c->arr[(r >> 33) % (unsigned long long)c->n];
+    }
+    introSortNoCount(sample, 0, nsample - 1);
+    for (int b = 0; b < nb - 1; b++) c->splitters[b] = sample[(b + 1) * SAMPLE_OVERSAMPLE];
+
+    // Per-block bucket counts
+    for (int i = 0; i < nblk; i++) {
+        args[i].c = c;
+        args[i].index = i;
+        wp_spawn(&g, sampleCountTask, &args[i]);
+    }
+    wp_sync(&g);
+
+    // Exclusive prefix sum in bucket-major order gives every (block, bucket)
+    // its own write range, so the scatter needs no synchronization
+    long pos = 0;
+    for (int b = 0; b < nb; b++) {
+        c->bucket_start[b] = pos;
+        for (int blk = 0; blk < nblk; blk++) {
+            long cnt = c->offsets[(size_t)blk * nb + b];
+            c->offsets[(size_t)blk * nb + b] = pos;
+            pos += cnt;
+        }
+    }
+    c->bucket_start[nb] = pos;
+
+    for (int i = 0; i < nblk; i++) wp_spawn(&g, sampleScatterTask, &args[i]);
+    wp_sync(&g);
+
+    for (int b = 0; b < nb; b++) {
+        args[b].c = c;
+        args[b].index = b;
+        wp_spawn(&g, sampleBucketTask, &args[b]);
+    }
+    wp_sync(&g);
+}
+
+// Sorts arr[0..n-1] on 'pool'. tmp as for parallelMergeSort. Inputs too small
+// to give every bucket a few grains go to parallelMergeSort instead. All
+// scratch is allocated here, before any task runs. Returns 0, or -1 if an
+// allocation fails (arr is then unchanged).
+static inline int parallelSampleSort(wp_pool *pool, int arr[], int n, int tmp[]) {
+    int nb = 4 * (int)pool->nworkers;
+    if (nb > SAMPLE_MAX_BUCKETS) nb = SAMPLE_MAX_BUCKETS;
+    if (nb < 2 || n / nb < PAR_SORT_GRAIN) return parallelMergeSort(pool, arr, n, tmp);
+
+    int *own = NULL;
+    if (tmp == NULL) {
+        own = malloc((size_t)n * sizeof(int));
+        if (own == NULL) return -1;
+        tmp = own;
+    }
+    ps_sample_ctx c;
+    c.arr = arr;
+    c.tmp = tmp;
+    c.n = n;
+    c.nbuckets = nb;
+    c.nblocks = 4 * (int)pool->nworkers;
+    c.splitters = malloc((size_t)(nb - 1) * sizeof(int));
+    c.offsets = calloc((size_t)c.nblocks * nb, sizeof(long));
+    c.bucket_start = malloc((size_t)(nb + 1) * sizeof(long));
+    c.sample = malloc((size_t)nb * SAMPLE_OVERSAMPLE * sizeof(int));
+    c.args = malloc((size_t)(nb > c.nblocks ? nb : c.nblocks) * sizeof(ps_sample_args));
+
+    int ok = c.splitters && c.offsets && c.bucket_start && c.sample && c.args;
+    if (ok) wp_run(pool, parallelSampleSortTask, &c);
+
+    free(c.splitters);
+    free(c.offsets);
+    free(c.bucket_start);
+    free(c.sample);
+    free(c.args);
+    free(own);
+    return ok ? 0 : -1;
+}
+
+#endif // PARSORT_H
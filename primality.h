@@ -0,0 +1,586 @@
+// primality.h
+// Shared primality helpers for milerrabin.c, solovay.c and RSA.c.
+// Header-only (static inline) so each benchmark still builds as a single
+// translation unit: gcc -O2 milerrabin.c -lgmp
+
+#ifndef PRIMALITY_H
+#define PRIMALITY_H
+
+#include <gmp.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+// --- Native 64-bit Miller-Rabin ----------------------------------------------
+// Deterministic for every n < 2^64 using the 7-base set of Jim Sinclair.
+// Arithmetic is Montgomery multiplication with R = 2^64 on unsigned __int128,
+// so no GMP allocation or dispatch is involved.
+
+static const uint64_t mr64_bases[7] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+static const unsigned mr64_small_primes[12] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+
+#define PRIME64_LANES 4  // candidates advanced in lockstep by is_prime_u64_batch
+
+typedef struct {
+    uint64_t n;
+    uint64_t ninv;   // n^-1 mod 2^64
+    uint64_t one;    // R mod n (Montgomery form of 1)
+    uint64_t r2;     // R^2 mod n
+} mont64_t;
+
+static inline void mont64_init(mont64_t *m, uint64_t n) {
+    uint64_t inv = n;                               // correct to 3 bits for odd n
+    for (int i = 0; i < 5; i++) inv *= 2 - n * inv; // 6, 12, 24, 48, 96 bits
+    m->n = n;
+    m->ninv = inv;
+    m->one = (0 - n) % n;
+    m->r2 = (uint64_t)(((unsigned __int128)m->one * m->one) % n);
+}
+
+// a * b * R^-1 mod n, for a, b < n.
+static inline uint64_t mont64_mul(uint64_t a, uint64_t b, const mont64_t *m) {
+    unsigned __int128 t = (unsigned __int128)a * b;
+    uint64_t q = (uint64_t)t * m->ninv;
+    uint64_t mn_hi = (uint64_t)(((unsigned __int128)q * m->n) >> 64);
+    uint64_t t_hi = (uint64_t)(t >> 64);
+    uint64_t r = t_hi - mn_hi;
+    return t_hi < mn_hi ? r + m->n : r;
+}
+
+static inline uint64_t mont64_to(uint64_t a, const mont64_t *m) {
+    return mont64_mul(a % m->n, m->r2, m);
+}
+
+// Montgomery-form base^e mod n.
+static inline uint64_t mont64_pow(uint64_t base_m, uint64_t e, const mont64_t *m) {
+    uint64_t x = m->one;
+    while (e) {
+        if (e & 1) x = mont64_mul(x, base_m, m);
+        base_m = mont64_mul(base_m, base_m, m);
+        e >>= 1;
+    }
+    return x;
+}
+
+// Trial division by the primes up to 37. Returns 1 (prime), 0 (composite),
+// or -1 when n is odd, > 37^2 and still undecided.
+static inline int prime64_trial(uint64_t n) {
+    if (n < 2) return 0;
+    for (int i = 0; i < 12; i++) {
+        if (n == mr64_small_primes[i]) return 1;
+        if (n % mr64_small_primes[i] == 0) return 0;
+    }
+    return n < 37 * 37 ? 1 : -1;
+}
+
+// Deterministic primality test for any 64-bit n.
+static inline int is_prime_u64(uint64_t n) {
+    int t = prime64_trial(n);
+    if (t >= 0) return t;
+
+    mont64_t m;
+    mont64_init(&m, n);
+    uint64_t d = n - 1;
+    unsigned s = (unsigned)__builtin_ctzll(d);
+    d >>= s;
+    uint64_t minus_one = n - m.one;
+
+    for (int b = 0; b < 7; b++) {
+        uint64_t a = mr64_bases[b] % n;
+        if (a == 0) continue;
+        uint64_t x = mont64_pow(mont64_to(a, &m), d, &m);
+        if (x == m.one || x == minus_one) continue;
+        unsigned r;
+        for (r = 1; r < s; r++) {
+            x = mont64_mul(x, x, &m);
+            if (x == minus_one) break;
+        }
+        if (r == s) return 0;
+    }
+    return 1;
+}
+
+// A candidate of is_prime_u64_batch that survived trial division, with its
+// Montgomery setup done once for all seven rounds.
+typedef struct {
+    mont64_t m;
+    size_t idx;      // position in the caller's array
+} mr64_cand_t;
+
+// One strong-probable-prime round to base a on up to PRIME64_LANES odd
+// candidates (> 37^2) in lockstep. The powering runs over a common bit
+// length with a fixed 2-bit window: two squarings and one multiply by a
+// per-lane table entry (1, a, a^2 or a^3) per step, 1.5 multiplications per
+// bit like the scalar path's average, but with no data-dependent branch, so
+// the lanes' independent multiply chains overlap. Clears alive[l] for lanes
+// proven composite; lanes already dead are skipped.
+static inline void mr64_round_lockstep(const mr64_cand_t *c, int lanes, uint64_t a, int *alive) {
+    uint64_t d[PRIME64_LANES], x[PRIME64_LANES], tab[PRIME64_LANES][4], minus_one[PRIME64_LANES];
+    unsigned s[PRIME64_LANES];
+    int done[PRIME64_LANES];
+    unsigned max_bits = 0, max_s = 0;
+
+    for (int l = 0; l < lanes; l++) {
+        const mont64_t *m = &c[l].m;
+        s[l] = (unsigned)__builtin_ctzll(m->n - 1);
+        d[l] = (m->n - 1) >> s[l];
+        minus_one[l] = m->n - m->one;
+        tab[l][0] = m->one;
+        tab[l][1] = mont64_to(a, m);
+        tab[l][2] = mont64_mul(tab[l][1], tab[l][1], m);
+        tab[l][3] = mont64_mul(tab[l][2], tab[l][1], m);
+        x[l] = m->one;
+        done[l] = !alive[l] || a % m->n == 0;
+        unsigned bits = 64 - (unsigned)__builtin_clzll(d[l]);
+        if (bits > max_bits) max_bits = bits;
+        if (s[l] > max_s) max_s = s[l];
+    }
+
+    // Left-to-right 2-bit windows over a common, even bit length.
+    for (int bit = (int)((max_bits + 1) & ~1u) - 2; bit >= 0; bit -= 2) {
+        for (int l = 0; l < lanes; l++) {
+            const mont64_t *m = &c[l].m;
+            x[l] = mont64_mul(x[l], x[l], m);
+            x[l] = mont64_mul(x[l], x[l], m);
+            x[l] = mont64_mul(x[l], tab[l][(d[l] >> bit) & 3], m);
+        }
+    }
+    for (int l = 0; l < lanes; l++) {
+        if (x[l] == c[l].m.one || x[l] == minus_one[l]) done[l] = 1;
+    }
+    for (unsigned r = 1; r < max_s; r++) {
+        for (int l = 0; l < lanes; l++) {
+            if (done[l] || r >= s[l]) continue;
+            x[l] = mont64_mul(x[l], x[l], &c[l].m);
+            if (x[l] == minus_one[l]) done[l] = 1;
+        }
+    }
+    for (int l = 0; l < lanes; l++) {
+        if (!done[l]) alive[l] = 0;
+    }
+}
+
+// Test count 64-bit candidates: out[i] = is_prime_u64(n[i]).
+// Works in passes: trial division, then base 2 over every remaining
+// candidate, then the other six bases over the (mostly prime) survivors only.
+// Each pass feeds groups of PRIME64_LANES candidates to mr64_round_lockstep.
+// 'work' must hold count entries; the survivors are compacted into it.
+static inline void is_prime_u64_batch_work(const uint64_t *n, uint8_t *out, size_t count,
+                                           mr64_cand_t *work) {
+    size_t live = 0;
+    for (size_t i = 0; i < count; i++) {
+        int t = prime64_trial(n[i]);
+        out[i] = (uint8_t)(t != 0);
+        if (t < 0) {
+            mont64_init(&work[live].m, n[i]);
+            work[live++].idx = i;
+        }
+    }
+
+    for (int b = 0; b < 7 && live > 0; b++) {
+        size_t kept = 0;
+        for (size_t g = 0; g < live; g += PRIME64_LANES) {
+            int lanes = live - g < PRIME64_LANES ? (int)(live - g) : PRIME64_LANES;
+            int alive[PRIME64_LANES];
+            for (int l = 0; l < lanes; l++) alive[l] = 1;
+            mr64_round_lockstep(work + g, lanes, mr64_bases[b], alive);
+            for (int l = 0; l < lanes; l++) {
+                if (alive[l]) work[kept++] = work[g + l];
+                else out[work[g + l].idx] = 0;
+            }
+        }
+        live = kept;
+    }
+}
+
+static inline void is_prime_u64_batch(const uint64_t *n, uint8_t *out, size_t count) {
+    mr64_cand_t *work = malloc(count * sizeof(mr64_cand_t));
+    is_prime_u64_batch_work(n, out, count, work);
+    free(work);
+}
+
+// If n fits in 64 bits, decide it with the native path and return 1 with the
+// answer in *result; return 0 when n needs the bignum route.
+static inline int prime64_dispatch(const mpz_t n, int *result) {
+    if (mpz_sgn(n) <= 0) {
+        *result = 0;
+        return 1;
+    }
+    if (mpz_sizeinbase(n, 2) > 64) return 0;
+    *result = is_prime_u64((uint64_t)mpz_get_ui(n));
+    return 1;
+}
+
+// --- Reusable primality context ------------------------------------------------
+// Everything that depends only on n is computed once by prime_ctx_set: n-1,
+// n-3, (n-1)/2, n-1 = 2^s * d and the Montgomery setup (n0inv, R mod n,
+// R^2 mod n). All mpz fields are preallocated and all limb scratch (window
+// table, product buffer) is owned by the context, so a Miller-Rabin or
+// Solovay-Strassen round performs no heap allocation. A context may be
+// re-bound to another n of at most max_bits bits without reallocating.
+
+#define PRIME_CTX_TABLE 32   // odd powers for sliding windows of up to 6 bits
+
+typedef struct {
+    size_t max_bits;
+    mp_size_t cap_limbs;
+    mpz_t n, n_minus_1, n_minus_3, half, d;   // half = (n-1)/2, n-1 = 2^s * d
+    unsigned s;
+    mpz_t a, g, tmp;                           // base, gcd and setup scratch
+    mp_size_t limbs;
+    mp_limb_t n0inv;                           // -n^-1 mod 2^GMP_NUMB_BITS
+    mp_limb_t *np, *r2, *one, *minus_one;      // n, R^2, R and n-R mod n as limbs
+    mp_limb_t *x, *base, *tp, *tab;            // round scratch
+} prime_ctx;
+
+static inline void prime_ctx_init(prime_ctx *ctx, size_t max_bits) {
+    mp_size_t cap = (mp_size_t)((max_bits + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS);
+    mp_bitcnt_t zbits = (mp_bitcnt_t)(2 * cap * GMP_NUMB_BITS + GMP_NUMB_BITS);
+    ctx->max_bits = max_bits;
+    ctx->cap_limbs = cap;
+    mpz_init2(ctx->n, zbits); mpz_init2(ctx->n_minus_1, zbits); mpz_init2(ctx->n_minus_3, zbits);
+    mpz_init2(ctx->half, zbits); mpz_init2(ctx->d, zbits);
+    mpz_init2(ctx->a, zbits); mpz_init2(ctx->g, zbits); mpz_init2(ctx->tmp, zbits);
+    ctx->np = malloc((size_t)(8 + PRIME_CTX_TABLE) * cap * sizeof(mp_limb_t));
+    ctx->r2 = ctx->np + cap;
+    ctx->one = ctx->r2 + cap;
+    ctx->minus_one = ctx->one + cap;
+    ctx->x = ctx->minus_one + cap;
+    ctx->base = ctx->x + cap;
+    ctx->tp = ctx->base + cap;                 // 2 * cap
+    ctx->tab = ctx->tp + 2 * cap;              // PRIME_CTX_TABLE * cap
+    ctx->limbs = 0;
+    ctx->s = 0;
+}
+
+static inline void prime_ctx_clear(prime_ctx *ctx) {
+    mpz_clears(ctx->n, ctx->n_minus_1, ctx->n_minus_3, ctx->half, ctx->d,
+               ctx->a, ctx->g, ctx->tmp, NULL);
+    free(ctx->np);
+}
+
+// Copy z into a zero-padded limb array of length 'limbs'.
+static inline void prime_ctx_limbs(mp_limb_t *rp, const mpz_t z, mp_size_t limbs) {
+    mp_size_t zn = (mp_size_t)mpz_size(z);
+    const mp_limb_t *zp = mpz_limbs_read(z);
+    for (mp_size_t i = 0; i < limbs; i++) rp[i] = i < zn ? zp[i] : 0;
+}
+
+// Bind the context to an odd n > 3 of at most max_bits bits.
+static inline void prime_ctx_set(prime_ctx *ctx, const mpz_t n) {
+    if (mpz_sizeinbase(n, 2) > ctx->max_bits) {
+        prime_ctx_clear(ctx);
+        prime_ctx_init(ctx, mpz_sizeinbase(n, 2));
+    }
+    mp_size_t limbs = (mp_size_t)mpz_size(n);
+    ctx->limbs = limbs;
+
+    mpz_set(ctx->n, n);
+    mpz_sub_ui(ctx->n_minus_1, n, 1);
+    mpz_sub_ui(ctx->n_minus_3, n, 3);
+    mpz_fdiv_q_2exp(ctx->half, ctx->n_minus_1, 1);
+    ctx->s = (unsigned)mpz_scan1(ctx->n_minus_1, 0);
+    mpz_fdiv_q_2exp(ctx->d, ctx->n_minus_1, ctx->s);
+
+    prime_ctx_limbs(ctx->np, n, limbs);
+    mp_limb_t n0 = ctx->np[0], inv = n0;       // Newton: 3 -> 6 -> ... -> 96 bits
+    for (int i = 0; i < 5; i++) inv *= 2 - n0 * inv;
+    ctx->n0inv = -inv;
+
+    mpz_set_ui(ctx->tmp, 0);
+    mpz_setbit(ctx->tmp, (mp_bitcnt_t)limbs * GMP_NUMB_BITS);
+    mpz_mod(ctx->tmp, ctx->tmp, n);                       // R mod n
+    prime_ctx_limbs(ctx->one, ctx->tmp, limbs);
+    mpz_sub(ctx->tmp, n, ctx->tmp);                       // n - R mod n = mont(-1)
+    prime_ctx_limbs(ctx->minus_one, ctx->tmp, limbs);
+    mpz_set_ui(ctx->tmp, 0);
+    mpz_setbit(ctx->tmp, 2 * (mp_bitcnt_t)limbs * GMP_NUMB_BITS);
+    mpz_mod(ctx->tmp, ctx->tmp, n);                       // R^2 mod n
+    prime_ctx_limbs(ctx->r2, ctx->tmp, limbs);
+}
+
+// rp = tp * R^-1 mod n for a 2*limbs product tp (clobbered); rp may alias nothing in tp.
+static inline void prime_ctx_redc(mp_limb_t *rp, mp_limb_t *tp, const prime_ctx *ctx) {
+    mp_size_t limbs = ctx->limbs;
+    for (mp_size_t i = 0; i < limbs; i++) {
+        mp_limb_t q = tp[i] * ctx->n0inv;
+        tp[i] = mpn_addmul_1(tp + i, ctx->np, limbs, q);   // park the carry in the zeroed limb
+    }
+    mp_limb_t cy = mpn_add_n(rp, tp + limbs, tp, limbs);
+    if (cy || mpn_cmp(rp, ctx->np, limbs) >= 0) mpn_sub_n(rp, rp, ctx->np, limbs);
+}
+
+static inline void prime_ctx_mul(mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp, prime_ctx *ctx) {
+    if (ap == bp) mpn_sqr(ctx->tp, ap, ctx->limbs);
+    else mpn_mul_n(ctx->tp, ap, bp, ctx->limbs);
+    prime_ctx_redc(rp, ctx->tp, ctx);
+}
+
+// Sliding-window width for an exponent of 'bits' bits.
+static inline int prime_ctx_window(size_t bits) {
+    return bits > 768 ? 6 : bits > 256 ? 5 : bits > 64 ? 4 : 3;
+}
+
+// ctx->x = mont(a^e mod n) for 0 <= a < n, left-to-right sliding window over
+// the odd powers a, a^3, ..., a^(2^w - 1).
+static inline void prime_ctx_powm(prime_ctx *ctx, const mpz_t a, const mpz_t e) {
+    mp_size_t limbs = ctx->limbs;
+    mp_limb_t *tab = ctx->tab, *a2 = ctx->x;
+    long bit = (long)mpz_sizeinbase(e, 2) - 1;
+    int w = prime_ctx_window((size_t)bit + 1);
+
+    prime_ctx_limbs(ctx->base, a, limbs);
+    prime_ctx_mul(tab, ctx->base, ctx->r2, ctx);                   // mont(a)
+    prime_ctx_mul(a2, tab, tab, ctx);                               // mont(a^2)
+    for (int i = 1; i < (1 << (w - 1)); i++) {
+        prime_ctx_mul(tab + i * limbs, tab + (i - 1) * limbs, a2, ctx);
+    }
+
+    mpn_copyi(ctx->x, ctx->one, limbs);
+    while (bit >= 0) {
+        if (!mpz_tstbit(e, (mp_bitcnt_t)bit)) {
+            prime_ctx_mul(ctx->x, ctx->x, ctx->x, ctx);
+            bit--;
+            continue;
+        }
+        // Longest window e[bit..low] of at most w bits that ends in a 1 bit
+        long low = bit - w + 1 < 0 ? 0 : bit - w + 1;
+        while (!mpz_tstbit(e, (mp_bitcnt_t)low)) low++;
+        unsigned val = 0;
+        for (long k = bit; k >= low; k--) {
+            val = (val << 1) | (unsigned)mpz_tstbit(e, (mp_bitcnt_t)k);
+            prime_ctx_mul(ctx->x, ctx->x, ctx->x, ctx);
+        }
+        prime_ctx_mul(ctx->x, ctx->x, tab + (val >> 1) * limbs, ctx);
+        bit = low - 1;
+    }
+}
+
+// ctx->a = uniform random base in [2, n-2].
+static inline void prime_ctx_random_base(prime_ctx *ctx, gmp_randstate_t st) {
+    mpz_urandomm(ctx->a, st, ctx->n_minus_3);
+    mpz_add_ui(ctx->a, ctx->a, 2);
+}
+
+// One Miller-Rabin round to base a in [2, n-2]. Returns 1 for "probably prime".
+static inline int prime_ctx_mr_round(prime_ctx *ctx, const mpz_t a) {
+    mp_size_t limbs = ctx->limbs;
+    prime_ctx_powm(ctx, a, ctx->d);
+    if (mpn_cmp(ctx->x, ctx->one, limbs) == 0 || mpn_cmp(ctx->x, ctx->minus_one, limbs) == 0) return 1;
+    for (unsigned r = 1; r < ctx->s; r++) {
+        prime_ctx_mul(ctx->x, ctx->x, ctx->x, ctx);
+        if (mpn_cmp(ctx->x, ctx->minus_one, limbs) == 0) return 1;
+    }
+    return 0;
+}
+
+// One Solovay-Strassen round to base a in [2, n-2]: gcd(a, n) = 1 and
+// a^((n-1)/2) = Jacobi(a, n) mod n. Returns 1 for "probably prime".
+static inline int prime_ctx_ss_round(prime_ctx *ctx, const mpz_t a) {
+    mpz_gcd(ctx->g, a, ctx->n);
+    if (mpz_cmp_ui(ctx->g, 1) != 0) return 0;
+    int jac = mpz_jacobi(a, ctx->n);
+    if (jac == 0) return 0;
+    prime_ctx_powm(ctx, a, ctx->half);
+    return mpn_cmp(ctx->x, jac == 1 ? ctx->one : ctx->minus_one, ctx->limbs) == 0;
+}
+
+// --- Baillie-PSW -------------------------------------------------------------
+// Strong probable-prime test to base 2 followed by a strong Lucas test with
+// Selfridge's parameters (method A). No composite is known to pass, and the
+// cost is about three modular exponentiations instead of one per round.
+
+// Which probable-prime test a generator uses. PRIME_TEST_DEFAULT keeps each
+// program's original test (Solovay-Strassen, Miller-Rabin or mpz_nextprime).
+typedef enum {
+    PRIME_TEST_DEFAULT,
+    PRIME_TEST_BPSW
+} prime_test_t;
+
+// Product of the odd primes 3..47; fits in 64 bits.
+#define SMALL_PRIMORIAL_ODD 307444891294245705UL
+static const unsigned bpsw_screen_primes[14] = {3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47};
+
+// Strong probable-prime test to base 2 for odd n > 3.
+static inline int strong_prp_base2(const mpz_t n) {
+    mpz_t d, x, n_minus_1;
+    mpz_inits(d, x, n_minus_1, NULL);
+    mpz_sub_ui(n_minus_1, n, 1);
+    mp_bitcnt_t s = mpz_scan1(n_minus_1, 0);
+    mpz_fdiv_q_2exp(d, n_minus_1, s);
+
+    mpz_set_ui(x, 2);
+    mpz_powm(x, x, d, n);
+    int res = mpz_cmp_ui(x, 1) == 0 || mpz_cmp(x, n_minus_1) == 0;
+    for (mp_bitcnt_t r = 1; r < s && !res; r++) {
+        mpz_mul(x, x, x);
+        mpz_mod(x, x, n);
+        if (mpz_cmp(x, n_minus_1) == 0) res = 1;
+    }
+
+    mpz_clears(d, x, n_minus_1, NULL);
+    return res;
+}
+
+// x = x / 2 mod n for odd n and 0 <= x < n.
+static inline void half_mod(mpz_t x, const mpz_t n) {
+    if (mpz_odd_p(x)) mpz_add(x, x, n);
+    mpz_fdiv_q_2exp(x, x, 1);
+}
+
+// Strong Lucas probable-prime test for odd n > 3 that is not a perfect square.
+// D is the first of 5, -7, 9, -11, ... with Jacobi(D, n) = -1; P = 1,
+// Q = (1 - D) / 4. Writes n + 1 = d * 2^s and accepts if U_d = 0 or
+// V_{d*2^r} = 0 for some 0 <= r < s.
+static inline int strong_lucas_prp(const mpz_t n) {
+    long D = 5;
+    mpz_t zD;
+    mpz_init(zD);
+    for (;;) {
+        mpz_set_si(zD, D);
+        int j = mpz_jacobi(zD, n);
+        if (j == -1) break;
+        if (j == 0 && mpz_cmpabs_ui(n, (unsigned long)(D < 0 ? -D : D)) != 0) {
+            mpz_clear(zD);
+            return 0;   // shares a factor with D
+        }
+        D = D > 0 ? -(D + 2) : -D + 2;
+    }
+    long Q = (1 - D) / 4;
+
+    mpz_t d, U, V, Qk, t;
+    mpz_inits(d, U, V, Qk, t, NULL);
+    mpz_add_ui(d, n, 1);
+    mp_bitcnt_t s = mpz_scan1(d, 0);
+    mpz_fdiv_q_2exp(d, d, s);
+
+    // Left-to-right: (U_k, V_k, Q^k) -> (U_2k, V_2k, Q^2k) [-> (U_2k+1, V_2k+1, Q^2k+1)]
+    mpz_set_ui(U, 1);
+    mpz_set_ui(V, 1);               // V_1 = P = 1
+    mpz_set_si(Qk, Q);
+    mpz_mod(Qk, Qk, n);
+    for (long bit = (long)mpz_sizeinbase(d, 2) - 2; bit >= 0; bit--) {
+        mpz_mul(U, U, V);                       // U_2k = U_k * V_k
+        mpz_mod(U, U, n);
+        mpz_mul(V, V, V);                       // V_2k = V_k^2 - 2 Q^k
+        mpz_submul_ui(V, Qk, 2);
+        mpz_mod(V, V, n);
+        mpz_mul(Qk, Qk, Qk);
+        mpz_mod(Qk, Qk, n);
+        if (mpz_tstbit(d, bit)) {
+            mpz_mul_si(t, U, D);                // t = D * U_2k
+            mpz_add(U, U, V);                   // U_2k+1 = (U_2k + V_2k) / 2
+            mpz_mod(U, U, n);
+            half_mod(U, n);
+            mpz_add(V, V, t);                   // V_2k+1 = (D U_2k + V_2k) / 2
+            mpz_mod(V, V, n);
+            half_mod(V, n);
+            mpz_mul_si(Qk, Qk, Q);
+            mpz_mod(Qk, Qk, n);
+        }
+    }
+
+    int res = mpz_sgn(U) == 0 || mpz_sgn(V) == 0;
+    for (mp_bitcnt_t r = 1; r < s && !res; r++) {
+        mpz_mul(V, V, V);                       // V_2k = V_k^2 - 2 Q^k
+        mpz_submul_ui(V, Qk, 2);
+        mpz_mod(V, V, n);
+        mpz_mul(Qk, Qk, Qk);
+        mpz_mod(Qk, Qk, n);
+        if (mpz_sgn(V) == 0) res = 1;
+    }
+
+    mpz_clears(zD, d, U, V, Qk, t, NULL);
+    return res;
+}
+
+// Baillie-PSW probable-prime test.
+static inline int is_probable_prime_bpsw(const mpz_t n) {
+    int small_result;
+    if (prime64_dispatch(n, &small_result)) return small_result;
+    if (mpz_even_p(n)) return 0;
+
+    unsigned long r = mpz_fdiv_ui(n, SMALL_PRIMORIAL_ODD);
+    for (int i = 0; i < 14; i++) {
+        if (r % bpsw_screen_primes[i] == 0) return 0;
+    }
+
+    if (!strong_prp_base2(n)) return 0;
+    if (mpz_perfect_square_p(n)) return 0;
+    return strong_lucas_prp(n);
+}
+
+// rop = smallest BPSW probable prime > op (counterpart of mpz_nextprime).
+static inline void bpsw_nextprime(mpz_t rop, const mpz_t op) {
+    if (mpz_cmp_ui(op, 2) < 0) {
+        mpz_set_ui(rop, 2);
+        return;
+    }
+    mpz_add_ui(rop, op, 1);
+    if (mpz_even_p(rop) && mpz_cmp_ui(rop, 2) != 0) mpz_add_ui(rop, rop, 1);
+    while (!is_probable_prime_bpsw(rop)) mpz_add_ui(rop, rop, 2);
+}
+
+// --- Batch small-prime screening -----------------------------------------------
+// Screens a batch of candidates against the product P of all primes up to
+// SCREEN_BOUND (about 4200 primes) at once, following Bernstein's remainder
+// tree: build the product tree of the candidates, reduce P down the tree to
+// get P mod x_i at every leaf, then a single gcd(P mod x_i, x_i) per candidate
+// says whether it has any screened factor. This is far deeper than a handful
+// of mpz_fdiv_ui calls and costs a small fraction of one modular exponentiation
+// per candidate.
+
+#define SCREEN_BOUND 40000UL
+#define SCREEN_BATCH 64
+
+typedef struct {
+    mpz_t P;                // primorial(SCREEN_BOUND)
+    size_t cap;             // leaves (power of two >= batch size)
+    mpz_t *tree;            // heap-ordered product tree, nodes 1 .. 2*cap-1
+} screen_ctx;
+
+static inline void screen_init(screen_ctx *sc, size_t batch) {
+    size_t cap = 1;
+    while (cap < batch) cap <<= 1;
+    sc->cap = cap;
+    mpz_init(sc->P);
+    mpz_primorial_ui(sc->P, SCREEN_BOUND);
+    sc->tree = malloc(2 * cap * sizeof(mpz_t));
+    for (size_t k = 0; k < 2 * cap; k++) mpz_init(sc->tree[k]);
+}
+
+static inline void screen_clear(screen_ctx *sc) {
+    for (size_t k = 0; k < 2 * sc->cap; k++) mpz_clear(sc->tree[k]);
+    free(sc->tree);
+    mpz_clear(sc->P);
+}
+
+// survive[i] = 1 if cand[i] has no prime factor <= SCREEN_BOUND. Candidates
+// must exceed SCREEN_BOUND (a screened prime would report itself as a factor).
+// count <= the batch size given to screen_init. Returns the number of survivors.
+static inline size_t screen_batch(screen_ctx *sc, const mpz_t *cand, size_t count, uint8_t *survive) {
+    size_t cap = sc->cap, alive = 0;
+    mpz_t *t = sc->tree;
+
+    for (size_t i = 0; i < cap; i++) {
+        if (i < count) mpz_set(t[cap + i], cand[i]);
+        else mpz_set_ui(t[cap + i], 1);
+    }
+    for (size_t k = cap - 1; k >= 1; k--) mpz_mul(t[k], t[2 * k], t[2 * k + 1]);
+
+    // Remainder tree, in place: node k becomes P mod (product under k)
+    mpz_mod(t[1], sc->P, t[1]);
+    for (size_t k = 1; k < cap; k++) {
+        mpz_mod(t[2 * k], t[k], t[2 * k]);
+        mpz_mod(t[2 * k + 1], t[k], t[2 * k + 1]);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        mpz_gcd(t[cap + i], t[cap + i], cand[i]);
+        survive[i] = mpz_cmp_ui(t[cap + i], 1) == 0;
+        alive += survive[i];
+    }
+    return alive;
+}
+
+#endif // PRIMALITY_H
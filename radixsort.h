@@ -0,0 +1,210 @@
+// radixsort.h
+// Radix sorts for int keys, for the sorting benchmarks:
+//   lsdRadixSort - least-significant-digit first, 11-bit digits (3 passes at
+//                  most for 32-bit keys). All digit histograms come from one
+//                  read of the input, digits that are equal for every key are
+//                  skipped, and the scatter goes through write-combining
+//                  buffers (one cache line per bucket) so every store to the
+//                  destination is a full, aligned line.
+//   msdRadixSort - hybrid for large key ranges: one MSD pass on the top digit
+//                  splits the keys into cache-sized buckets, each finished by
+//                  the LSD passes on the remaining bits (or insertion sort when
+//                  tiny).
+// Keys are flipped at the sign bit on the way in and out, so negative ints
+// order correctly as unsigned digits. Both sorts return the number of scatter
+// passes made and count every element written by a pass (or by the final copy
+// back into arr) as one move in 'swaps'; no key comparisons are made except in
+// the insertion sort of tiny MSD buckets.
+
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sorting.h"
+
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_DIGITS ((32 + RADIX_BITS - 1) / RADIX_BITS)
+#define RADIX_WC 16     // ints per write-combining buffer (one 64-byte line)
+#define RADIX_WC_MIN (1 << 18) // smaller scatters stay in cache; write directly
+#define RADIX_SMALL 64  // MSD buckets up to this size use insertion sort
+
+typedef struct {
+    unsigned lines[RADIX_BUCKETS][RADIX_WC];
+    unsigned char fill[RADIX_BUCKETS];
+    unsigned char limit[RADIX_BUCKETS]; // keys until the next line boundary in dst
+} radix_wc;
+
+// Stable scatter of src[0..n) into dst by the digit at 'shift'; offsets[d]
+// holds the first destination index of bucket d. Below RADIX_WC_MIN keys the
+// destination fits in cache and the buffering only adds work (about 20% slower
+// on cache-resident MSD buckets; about 20% faster on 5*10^7-key passes).
+static inline void radixScatter(const unsigned *src, unsigned *dst, int n, int shift,
+                                int width, size_t *offsets, radix_wc *wc) {
+    unsigned mask = (1u << width) - 1;
+    int buckets = 1 << width;
+    swaps += (unsigned long long)n;
+    if (n < RADIX_WC_MIN) {
+        for (int i = 0; i < n; i++) {
+            unsigned key = src[i];
+            dst[offsets[(key >> shift) & mask]++] = key;
+        }
+        return;
+    }
+
+    for (int d = 0; d < buckets; d++) {
+        wc->fill[d] = 0;
+        wc->limit[d] = (unsigned char)(RADIX_WC - ((uintptr_t)(dst + offsets[d]) / sizeof(unsigned)) % RADIX_WC);
+    }
+    for (int i = 0; i < n; i++) {
+        unsigned key = src[i];
+        unsigned d = (key >> shift) & mask;
+        wc->lines[d][wc->fill[d]++] = key;
+        if (wc->fill[d] == wc->limit[d]) {
+            memcpy(dst + offsets[d], wc->lines[d], wc->fill[d] * sizeof(unsigned));
+            offsets[d] += wc->fill[d];
+            wc->fill[d] = 0;
+            wc->limit[d] = RADIX_WC;
+        }
+    }
+    for (int d = 0; d < buckets; d++) {
+        memcpy(dst + offsets[d], wc->lines[d], wc->fill[d] * sizeof(unsigned));
+        offsets[d] += wc->fill[d];
+    }
+}
+
+// LSD passes over bits [0, bits) of keys[0..n), ping-ponging with tmp.
+// Returns the buffer that holds the result; *passes counts executed passes.
+static inline unsigned *radixLsd(unsigned *keys, unsigned *tmp, int n, int bits,
+                                 radix_wc *wc, int *passes) {
+    static _Thread_local size_t hist[RADIX_DIGITS][RADIX_BUCKETS];
+    int digits = (bits + RADIX_BITS - 1) / RADIX_BITS;
+
+    unsigned mask[RADIX_DIGITS];
+    for (int p = 0; p < digits; p++) {
+        int width = bits - p * RADIX_BITS < RADIX_BITS ? bits - p * RADIX_BITS : RADIX_BITS;
+        mask[p] = (1u << width) - 1;
+    }
+
+    memset(hist, 0, sizeof(hist));
+    for (int i = 0; i < n; i++) {
+        unsigned key = keys[i];
+        for (int p = 0; p < digits; p++) hist[p][(key >> (p * RADIX_BITS)) & mask[p]]++;
+    }
+
+    unsigned *src = keys, *dst = tmp;
+    for (int p = 0; p < digits; p++) {
+        int shift = p * RADIX_BITS;
+        // A digit shared by every key leaves the order unchanged
+        if (hist[p][(keys[0] >> shift) & mask[p]] == (size_t)n) continue;
+
+        size_t offsets[RADIX_BUCKETS], sum = 0;
+        for (unsigned d = 0; d <= mask[p]; d++) {
+            offsets[d] = sum;
+            sum += hist[p][d];
+        }
+        radixScatter(src, dst, n, shift, __builtin_popcount(mask[p]), offsets, wc);
+        unsigned *t = src; src = dst; dst = t;
+        (*passes)++;
+    }
+    return src;
+}
+
+static inline void radixFlip(unsigned *keys, int n) {
+    for (int i = 0; i < n; i++) keys[i] ^= 0x80000000u;
+}
+
+// Sorts arr[0..n-1]. buf must hold n ints, or be NULL to allocate one for the
+// call. Returns the number of passes, or -1 if allocation fails.
+static inline int lsdRadixSort(int arr[], int n, int buf[]) {
+    int passes = 0;
+    if (n < 2) return 0;
+    int *own = NULL;
+    radix_wc *wc = malloc(sizeof(radix_wc));
+    if (buf == NULL) buf = own = malloc((size_t)n * sizeof(int));
+    if (wc == NULL || buf == NULL) {
+        free(wc);
+        free(own);
+        return -1;
+    }
+
+    unsigned *keys = (unsigned *)arr;
+    radixFlip(keys, n);
+    unsigned *res = radixLsd(keys, (unsigned *)buf, n, 32, wc, &passes);
+    if (res != keys) {
+        memcpy(keys, res, (size_t)n * sizeof(unsigned));
+        swaps += (unsigned long long)n;
+    }
+    radixFlip(keys, n);
+
+    free(wc);
+    free(own);
+    return passes;
+}
+
+// Hybrid: MSD pass on the top RADIX_BITS bits, then LSD on the low bits of
+// every bucket (whose keys and scratch space stay within cache for large n).
+static inline int msdRadixSort(int arr[], int n, int buf[]) {
+    const int low_bits = 32 - RADIX_BITS;
+    int passes = 0;
+    if (n < 2) return 0;
+    int *own = NULL;
+    radix_wc *wc = malloc(sizeof(radix_wc));
+    if (buf == NULL) buf = own = malloc((size_t)n * sizeof(int));
+    if (wc == NULL || buf == NULL) {
+        free(wc);
+        free(own);
+        return -1;
+    }
+
+    unsigned *keys = (unsigned *)arr, *tmp = (unsigned *)buf;
+    radixFlip(keys, n);
+
+    size_t count[RADIX_BUCKETS] = {0}, offsets[RADIX_BUCKETS], sum = 0;
+    for (int i = 0; i < n; i++) count[keys[i] >> low_bits]++;
+    for (int d = 0; d < RADIX_BUCKETS; d++) {
+        offsets[d] = sum;
+        sum += count[d];
+    }
+    if (count[keys[0] >> low_bits] == (size_t)n) {
+        // Top digit constant: plain LSD over the rest
+        unsigned *res = radixLsd(keys, tmp, n, low_bits, wc, &passes);
+        if (res != keys) {
+            memcpy(keys, res, (size_t)n * sizeof(unsigned));
+            swaps += (unsigned long long)n;
+        }
+        radixFlip(keys, n);
+    } else {
+        radixScatter(keys, tmp, n, low_bits, RADIX_BITS, offsets, wc);
+        passes++;
+        int max_passes = 0;
+        for (size_t start = 0, d = 0; d < RADIX_BUCKETS; start += count[d], d++) {
+            int len = (int)count[d];
+            if (len == 0) continue;
+            unsigned *res = tmp + start;
+            if (len <= RADIX_SMALL) {
+                radixFlip(res, len);
+                insertionSort((int *)res, 0, len - 1);
+            } else {
+                int bucket_passes = 0;
+                res = radixLsd(tmp + start, keys + start, len, low_bits, wc, &bucket_passes);
+                if (bucket_passes > max_passes) max_passes = bucket_passes;
+                radixFlip(res, len);
+            }
+            if (res != keys + start) {
+                memcpy(keys + start, res, (size_t)len * sizeof(unsigned));
+                swaps += (unsigned long long)len;
+            }
+        }
+        passes += max_passes;
+    }
+
+    free(wc);
+    free(own);
+    return passes;
+}
+
+#endif // RADIXSORT_H
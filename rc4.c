@@ -1,63 +1,35 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
-#define N 256
-
-void swap(unsigned char *a, unsigned char *b) {
-    unsigned char temp = *a;
-    *a = *b;
-    *b = temp;
-}
-
-void ksa(unsigned char *S, const unsigned char *key, int key_len, clock_t *ksa_clocks) {
-    clock_t start = clock();
-    for (int i = 0; i < N; i++) {
-        S[i] = i;
-    }
-    int j = 0;
-    for (int i = 0; i < N; i++) {
-        j = (j + S[i] + key[i % key_len]) % N;
-        swap(&S[i], &S[j]);
-    }
-    *ksa_clocks = clock() - start;
-}
-
-void prga(unsigned char *S, unsigned char *plaintext, unsigned char *ciphertext, int len, clock_t *prga_clocks) {
-    clock_t start = clock();
-    int i = 0, j = 0;
-    for (int k = 0; k < len; k++) {
-        i = (i + 1) % N;
-        j = (j + S[i]) % N;
-        swap(&S[i], &S[j]);
-        int t = (S[i] + S[j]) % N;
-        ciphertext[k] = plaintext[k] ^ S[t];
-    }
-    *prga_clocks = clock() - start;
-}
+#include "benchutil.h"
+#include "rc4.h"
 
 int main() {
-    unsigned char S[N];
+    rc4_ctx ctx;
     const unsigned char *key = (unsigned char *)"SecretKey";
     int key_len = strlen((char *)key);
     unsigned char plaintext[] = "Hello, RC4!";
     int plaintext_len = strlen((char *)plaintext);
     unsigned char ciphertext[plaintext_len];
     
-    clock_t ksa_clocks, prga_clocks;
-
-    ksa(S, key, key_len, &ksa_clocks);
-    prga(S, plaintext, ciphertext, plaintext_len, &prga_clocks);
+    // clock() ticks are far too coarse for an 11-byte message: count TSC
+    // cycles instead (cipherbench.c measures throughput over message sizes)
+    uint64_t t0 = read_tsc();
+    rc4_init(&ctx, key, key_len);
+    uint64_t t1 = read_tsc();
+    rc4_xor(&ctx, plaintext, ciphertext, plaintext_len);
+    uint64_t t2 = read_tsc();
+    unsigned long long ksa_cycles = t1 - t0, prga_cycles = t2 - t1;
 
     printf("Plaintext: %s\n", plaintext);
     printf("Ciphertext (hex): ");
     for (int i = 0; i < plaintext_len; i++) {
         printf("%02x ", ciphertext[i]);
     }
-    printf("\nKSA Clock Ticks: %ld\n", ksa_clocks);
-    printf("PRGA Clock Ticks: %ld\n", prga_clocks);
-    printf("Total Clock Ticks: %ld\n", ksa_clocks + prga_clocks);
+    printf("\nKSA Clock Cycles: %llu\n", ksa_cycles);
+    printf("PRGA Clock Cycles: %llu\n", prga_cycles);
+    printf("Total Clock Cycles: %llu\n", ksa_cycles + prga_cycles);
 
     return 0;
 }
@@ -0,0 +1,52 @@
+// rc4.h
+// RC4, shared by rc4.c and cipherbench.c.
+//   rc4_ctx  - the 256-byte permutation S and the two PRGA indices
+//   rc4_init - key-scheduling algorithm (KSA) for a 1..256 byte key
+//   rc4_xor  - encrypts or decrypts with the pseudo-random generation
+//              algorithm (PRGA), continuing the keystream across calls
+// RC4 is broken (biased keystream) and only kept for comparison.
+
+#ifndef RC4_H
+#define RC4_H
+
+#include <stddef.h>
+
+#define RC4_N 256
+
+typedef struct {
+    unsigned char S[RC4_N];
+    unsigned char i, j;
+} rc4_ctx;
+
+static inline void rc4_init(rc4_ctx *ctx, const unsigned char *key, int key_len) {
+    unsigned char *S = ctx->S;
+    for (int i = 0; i < RC4_N; i++) {
+        S[i] = (unsigned char)i;
+    }
+    unsigned char j = 0;
+    for (int i = 0; i < RC4_N; i++) {
+        j = (unsigned char)(j + S[i] + key[i % key_len]);
+        unsigned char temp = S[i];
+        S[i] = S[j];
+        S[j] = temp;
+    }
+    ctx->i = 0;
+    ctx->j = 0;
+}
+
+static inline void rc4_xor(rc4_ctx *ctx, const unsigned char *in, unsigned char *out, size_t len) {
+    unsigned char *S = ctx->S;
+    unsigned char i = ctx->i, j = ctx->j;
+    for (size_t k = 0; k < len; k++) {
+        i = (unsigned char)(i + 1);
+        j = (unsigned char)(j + S[i]);
+        unsigned char temp = S[i];
+        S[i] = S[j];
+        S[j] = temp;
+        out[k] = in[k] ^ S[(unsigned char)(S[i] + S[j])];
+    }
+    ctx->i = i;
+    ctx->j = j;
+}
+
+#endif // RC4_H
@@ -0,0 +1,291 @@
+// safeprime.c
+// Safe-prime generation (p = 2q + 1 with q prime) for Diffie-Hellman groups.
+// Candidates q ≡ 5 (mod 6) are sieved in windows against every prime below
+// SIEVE_BOUND, striking q when r | q or r | 2q + 1, so only pairs where both
+// halves are free of small factors reach a modular exponentiation. Survivors
+// get the cheap strong base-2 test on q first; p is touched only if q passes.
+// Worker threads search independent random windows and stop at the first hit.
+//
+// Build: gcc -O2 -pthread safeprime.c -lgmp -lm
+// Usage: ./a.out [bits] [count] [threads] [seed]
+// Without arguments, sweeps 512, 1024 and 2048 bits. The search is reproducible
+// for a given seed only with one thread (workers race for the first hit).
+// GMP allocations are pooled (gmparena.h); GMP_ARENA=off for plain malloc.
+
+#include <gmp.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "benchutil.h"
+#include "gmparena.h"
+#include "primality.h"
+
+// --- Tunable params ----------------------------------------------------------
+
+#define SIEVE_BOUND  (1u << 20)   // sieve primes r < SIEVE_BOUND (about 82000)
+#define SIEVE_WINDOW (1u << 15)   // candidates q = q0 + 6i, 0 <= i < SIEVE_WINDOW
+
+// Twin prime constant, for the Hardy-Littlewood Sophie Germain density.
+#define TWIN_PRIME_C2 0.6601618158468696
+
+// --- Sieve primes ------------------------------------------------------------
+
+// Odd primes 5 <= r < SIEVE_BOUND with 6^-1 mod r, shared read-only by workers.
+typedef struct {
+    uint32_t *r;
+    uint32_t *inv6;
+    size_t count;
+} sieve_primes;
+
+static uint32_t inv_mod_u32(uint32_t a, uint32_t m) {
+    int64_t t = 0, new_t = 1, r = m, new_r = a % m;
+    while (new_r != 0) {
+        int64_t quot = r / new_r, tmp;
+        tmp = t - quot * new_t; t = new_t; new_t = tmp;
+        tmp = r - quot * new_r; r = new_r; new_r = tmp;
+    }
+    return (uint32_t)(t < 0 ? t + m : t);
+}
+
+static void sieve_primes_init(sieve_primes *sp) {
+    uint8_t *composite = calloc(SIEVE_BOUND, 1);
+    sp->r = malloc(SIEVE_BOUND / 8 * sizeof(uint32_t));
+    sp->inv6 = malloc(SIEVE_BOUND / 8 * sizeof(uint32_t));
+    sp->count = 0;
+    for (uint32_t i = 2; i < SIEVE_BOUND; i++) {
+        if (composite[i]) continue;
+        for (uint64_t j = (uint64_t)i * i; j < SIEVE_BOUND; j += i) composite[j] = 1;
+        if (i < 5) continue;
+        sp->r[sp->count] = i;
+        sp->inv6[sp->count] = inv_mod_u32(6, i);
+        sp->count++;
+    }
+    free(composite);
+}
+
+static void sieve_primes_clear(sieve_primes *sp) {
+    free(sp->r);
+    free(sp->inv6);
+}
+
+// --- Parallel search ---------------------------------------------------------
+
+typedef struct {
+    unsigned bits;              // size of p
+    const sieve_primes *sp;
+    pthread_mutex_t lock;
+    int done;                   // set once a safe prime is found
+    mpz_t p, q;                 // result
+} sp_search;
+
+typedef struct {
+    sp_search *s;
+    uint64_t seed;
+    unsigned long candidates;   // q values covered by the sieve
+    unsigned long survivors;    // q values that survived the sieve (q tests)
+    unsigned long p_tests;      // q passed base 2, p tested
+} sp_task;
+
+// Random q0 with bits-1 bits (top bit set) and q0 ≡ 5 (mod 6): q ≡ 1 (mod 3)
+// would make 3 | 2q + 1, and q must be odd.
+static void random_q0(mpz_t q0, unsigned qbits, gmp_randstate_t st) {
+    mpz_urandomb(q0, st, qbits);
+    mpz_setbit(q0, qbits - 1);
+    unsigned long m = mpz_fdiv_ui(q0, 6);
+    mpz_add_ui(q0, q0, (5 + 6 - m) % 6);
+}
+
+// Mark i in the window where q0 + 6i ≡ 0 or (r-1)/2 (mod r), i.e. where r
+// divides q or 2q + 1. res[k] holds q0 mod r_k and is advanced past the window.
+static void sieve_window(uint8_t *dead, uint32_t *res, const sieve_primes *sp) {
+    memset(dead, 0, SIEVE_WINDOW);
+    for (size_t k = 0; k < sp->count; k++) {
+        uint64_t r = sp->r[k], inv6 = sp->inv6[k], m = res[k];
+        uint64_t i0 = (r - m) * inv6 % r;                   // q ≡ 0
+        uint64_t i1 = ((r - 1) / 2 + r - m) * inv6 % r;     // 2q + 1 ≡ 0
+        for (uint64_t i = i0; i < SIEVE_WINDOW; i += r) dead[i] = 1;
+        for (uint64_t i = i1; i < SIEVE_WINDOW; i += r) dead[i] = 1;
+        res[k] = (uint32_t)((m + 6ULL * SIEVE_WINDOW) % r);
+    }
+}
+
+static void *sp_worker(void *arg) {
+    sp_task *task = arg;
+    sp_search *s = task->s;
+    const sieve_primes *sp = s->sp;
+    unsigned qbits = s->bits - 1;
+    gmp_randstate_t st;
+    mpz_t q0, q, p, x, two_q;
+    uint8_t *dead = malloc(SIEVE_WINDOW);
+    uint32_t *res = malloc(sp->count * sizeof(uint32_t));
+
+    gmp_randinit_mt(st);
+    gmp_randseed_ui(st, (unsigned long)task->seed);
+    mpz_inits(q0, q, p, x, two_q, NULL);
+
+    while (!__atomic_load_n(&s->done, __ATOMIC_RELAXED)) {
+        random_q0(q0, qbits, st);
+        for (size_t k = 0; k < sp->count; k++) res[k] = (uint32_t)mpz_fdiv_ui(q0, sp->r[k]);
+
+        // A few windows per start; the top bit of q survives since 6·W << 2^(qbits-1)
+        for (int w = 0; w < 4 && !__atomic_load_n(&s->done, __ATOMIC_RELAXED); w++) {
+            sieve_window(dead, res, sp);
+            for (unsigned i = 0; i < SIEVE_WINDOW; i++) {
+                task->candidates++;
+                if (dead[i]) continue;
+                if (__atomic_load_n(&s->done, __ATOMIC_RELAXED)) break;
+                task->survivors++;
+
+                mpz_add_ui(q, q0, 6UL * i);
+                if (!strong_prp_base2(q)) continue;             // cheap test on q
+
+                // 2^(p-1) ≡ 1 (mod p). Once q is prime this proves p prime
+                // (Pocklington: q | p-1, q > sqrt(p) - 1, and 3 ∤ p by the sieve).
+                task->p_tests++;
+                mpz_mul_2exp(two_q, q, 1);
+                mpz_add_ui(p, two_q, 1);
+                mpz_set_ui(x, 2);
+                mpz_powm(x, x, two_q, p);
+                if (mpz_cmp_ui(x, 1) != 0) continue;
+
+                // Complete BPSW on q (base 2 already done above)
+                if (mpz_perfect_square_p(q) || !strong_lucas_prp(q)) continue;
+
+                pthread_mutex_lock(&s->lock);
+                if (!s->done) {
+                    mpz_set(s->p, p);
+                    mpz_set(s->q, q);
+                    __atomic_store_n(&s->done, 1, __ATOMIC_RELAXED);
+                }
+                pthread_mutex_unlock(&s->lock);
+                break;
+            }
+            mpz_add_ui(q0, q0, 6UL * SIEVE_WINDOW);
+        }
+    }
+
+    mpz_clears(q0, q, p, x, two_q, NULL);
+    gmp_randclear(st);
+    free(res);
+    free(dead);
+    return NULL;
+}
+
+// Generate one safe prime p = 2q + 1 of exactly 'bits' bits on 'threads'
+// workers. 'stream' selects the seed streams of this search. Work counters of
+// all workers are accumulated into *total.
+static void generate_safe_prime(mpz_t p, mpz_t q, unsigned bits, unsigned threads,
+                                uint64_t seed, uint64_t stream,
+                                const sieve_primes *sp, sp_task *total) {
+    sp_search s;
+    s.bits = bits;
+    s.sp = sp;
+    s.done = 0;
+    pthread_mutex_init(&s.lock, NULL);
+    mpz_inits(s.p, s.q, NULL);
+
+    sp_task *tasks = calloc(threads, sizeof(sp_task));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    for (unsigned t = 0; t < threads; t++) {
+        tasks[t].s = &s;
+        tasks[t].seed = splitmix64(seed ^ splitmix64(stream * threads + t + 1));
+        pthread_create(&tids[t], NULL, sp_worker, &tasks[t]);
+    }
+    for (unsigned t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        total->candidates += tasks[t].candidates;
+        total->survivors += tasks[t].survivors;
+        total->p_tests += tasks[t].p_tests;
+    }
+
+    mpz_set(p, s.p);
+    mpz_set(q, s.q);
+    mpz_clears(s.p, s.q, NULL);
+    pthread_mutex_destroy(&s.lock);
+    free(tids);
+    free(tasks);
+}
+
+// --- Expected cost -----------------------------------------------------------
+
+// Hardy-Littlewood: a random q near 2^(bits-1) is a Sophie Germain prime with
+// probability ~ 2·C2 / (ln q · ln 2q). Among q ≡ 5 (mod 6) the odds are 6x
+// higher, and a fraction prod_{5 <= r < B} (1 - 2/r) survives the sieve.
+static void expected_costs(unsigned bits, const sieve_primes *sp,
+                           double *per_candidate, double *per_survivor) {
+    double lq = (bits - 1) * log(2.0), lp = bits * log(2.0);
+    double success = 6.0 * 2.0 * TWIN_PRIME_C2 / (lq * lp);
+    double survive = 1.0;
+    for (size_t k = 0; k < sp->count; k++) survive *= 1.0 - 2.0 / sp->r[k];
+    *per_candidate = 1.0 / success;
+    *per_survivor = survive / success;
+}
+
+static void run_size(unsigned bits, unsigned count, unsigned threads, uint64_t seed,
+                     const sieve_primes *sp) {
+    sp_task total = {0};
+    mpz_t p, q;
+    mpz_inits(p, q, NULL);
+
+    double t0 = now_seconds();
+    for (unsigned i = 0; i < count; i++) {
+        generate_safe_prime(p, q, bits, threads, seed, (uint64_t)bits << 32 | i, sp, &total);
+        if (mpz_sizeinbase(p, 2) != bits || !is_probable_prime_bpsw(p)) {
+            fprintf(stderr, "safe prime check failed at %u bits\n", bits);
+            exit(1);
+        }
+    }
+    double elapsed = now_seconds() - t0;
+
+    double exp_cand, exp_surv;
+    expected_costs(bits, sp, &exp_cand, &exp_surv);
+    printf("\n%u-bit safe primes: %u in %.3f s (%.3f s each, %u threads)\n",
+           bits, count, elapsed, elapsed / count, threads);
+    printf("  candidates q per success:  expected %10.0f  observed %10.0f\n",
+           exp_cand, (double)total.candidates / count);
+    printf("  sieve survivors per success: expected %8.0f  observed %10.0f\n",
+           exp_surv, (double)total.survivors / count);
+    printf("  p tests per success (q passed base 2): %.2f\n", (double)total.p_tests / count);
+    printf("  last p (hex): ");
+    mpz_out_str(stdout, 16, p);
+    printf("\n");
+
+    mpz_clears(p, q, NULL);
+}
+
+int main(int argc, char **argv) {
+    unsigned bits = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 0;
+    unsigned count = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 10) : 1;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned threads = argc > 3 ? (unsigned)strtoul(argv[3], NULL, 10) : (unsigned)(ncpu > 0 ? ncpu : 1);
+    uint64_t seed = argc > 4 ? (uint64_t)strtoull(argv[4], NULL, 0) : random_seed64();
+    if ((argc > 1 && bits < 64) || count == 0 || threads == 0) {
+        fprintf(stderr, "usage: %s [bits >= 64] [count] [threads] [seed]\n", argv[0]);
+        return 1;
+    }
+    gmp_arena_install(GMP_ARENA_POOL);
+
+    sieve_primes sp;
+    sieve_primes_init(&sp);
+    printf("Seed: %llu, threads: %u, sieve primes: %zu (< %u)\n",
+           (unsigned long long)seed, threads, sp.count, SIEVE_BOUND);
+
+    if (bits) {
+        run_size(bits, count, threads, seed, &sp);
+    } else {
+        run_size(512, 16, threads, seed, &sp);
+        run_size(1024, 4, threads, seed, &sp);
+        run_size(2048, 1, threads, seed, &sp);
+    }
+
+    sieve_primes_clear(&sp);
+    gmp_arena_report(stdout);
+    gmp_arena_release();
+    return 0;
+}
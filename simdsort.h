@@ -0,0 +1,521 @@
+// simdsort.h
+// Vectorized sort kernels for int arrays:
+//   simdSort       - quicksort whose partition step classifies a whole vector
+//                    per compare and writes both sides with compress-stores
+//                    (AVX-512 VPCOMPRESSD; AVX2 via a PEXT-built permutation),
+//                    with bitonic sorting networks for ranges of up to 64 ints
+//                    held in 1-8 registers.
+//   simdMergeSort  - 64-int blocks sorted by the network, then bottom-up merges
+//                    whose inner step is a register-to-register bitonic merge.
+// Neither updates the comparison/swap counters of sorting.h: the work is done
+// a vector at a time, so there is no per-key comparison to count.
+//
+// The kernels are compiled with target attributes, so no -m flags are needed.
+// Dispatch (cpudispatch.h) picks AVX-512F, then AVX2+BMI2, then the uncounted
+// (NoCount) scalar sorts of sorting.h; SIMDSORT_IMPL=avx512 / avx2 / scalar
+// forces a path (if the CPU has it). A vector path must first sort a fixed
+// pseudo-random array and merge two runs correctly.
+
+#ifndef SIMDSORT_H
+#define SIMDSORT_H
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "cpudispatch.h"
+#include "sorting.h"
+
+#define SIMD_SMALL 64 // ranges up to this size go to the sorting network
+
+typedef enum {
+    SIMDSORT_SCALAR,
+    SIMDSORT_AVX2,
+    SIMDSORT_AVX512
+} simdsort_impl_t;
+
+static inline const char *simdsort_impl_name(simdsort_impl_t impl) {
+    return impl == SIMDSORT_AVX512 ? "avx512" : impl == SIMDSORT_AVX2 ? "avx2" : "scalar";
+}
+
+// Lanes whose index has bit log2(j) set, for j = 1, 2, 4, 8
+static const uint16_t simd_lanebit[9] = {0, 0xAAAA, 0xCCCC, 0, 0xF0F0, 0, 0, 0, 0xFF00};
+
+// --- AVX-512: 16 lanes -------------------------------------------------------
+
+// One compare-exchange step of a bitonic network inside a register: lane i
+// pairs with lane i^j and keeps the max where takemax has its bit set.
+__attribute__((target("avx512f")))
+static inline __m512i simd512_step(__m512i v, int j, __mmask16 takemax) {
+    const __m512i iota = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    __m512i other = _mm512_permutexvar_epi32(_mm512_xor_si512(iota, _mm512_set1_epi32(j)), v);
+    return _mm512_mask_mov_epi32(_mm512_min_epi32(v, other), takemax, _mm512_max_epi32(v, other));
+}
+
+// Full bitonic sort of the 16*R ints in v[0..R-1] (R = 1, 2 or 4), ascending
+// across registers.
+__attribute__((target("avx512f")))
+static inline void simd512_network(__m512i *v, int R) {
+    for (int k = 2; k <= 16 * R; k <<= 1) {
+        for (int j = k >> 1; j > 0; j >>= 1) {
+            for (int r = 0; r < R; r++) {
+                if (j >= 16) {
+                    int p = r ^ (j >> 4);
+                    if (p < r || p >= R) continue;
+                    __m512i lo = _mm512_min_epi32(v[r], v[p]), hi = _mm512_max_epi32(v[r], v[p]);
+                    int asc = ((16 * r) & k) == 0;
+                    v[r] = asc ? lo : hi;
+                    v[p] = asc ? hi : lo;
+                } else {
+                    __mmask16 dir = k < 16 ? simd_lanebit[k] : ((16 * r) & k) ? 0xFFFF : 0;
+                    v[r] = simd512_step(v[r], j, simd_lanebit[j] ^ dir);
+                }
+            }
+        }
+    }
+}
+
+// Sorts arr[0..n-1] for n <= 64; missing lanes are padded with INT_MAX.
+__attribute__((target("avx512f")))
+static inline void simd512_sort_small(int *arr, int n) {
+    __m512i v[4];
+    int R = n <= 16 ? 1 : n <= 32 ? 2 : 4;
+    for (int r = 0; r < R; r++) {
+        int cnt = n - 16 * r < 0 ? 0 : n - 16 * r > 16 ? 16 : n - 16 * r;
+        __mmask16 m = (__mmask16)((1u << cnt) - 1);
+        v[r] = _mm512_mask_loadu_epi32(_mm512_set1_epi32(INT_MAX), m, arr + 16 * r);
+    }
+    simd512_network(v, R);
+    for (int r = 0; r < R; r++) {
+        int cnt = n - 16 * r < 0 ? 0 : n - 16 * r > 16 ? 16 : n - 16 * r;
+        _mm512_mask_storeu_epi32(arr + 16 * r, (__mmask16)((1u << cnt) - 1), v[r]);
+    }
+}
+
+// Partitions arr[0..n-1] (n >= 32) in place: keys < pivot (<= pivot if le)
+// first. Returns the size of the left part. Two vectors are held back in
+// registers, and each step reads from the side with less free space, so the
+// compress-stores never overwrite unread keys.
+__attribute__((target("avx512f")))
+static inline int simd512_partition(int *arr, int n, int pivot, int le) {
+    const __m512i vp = _mm512_set1_epi32(pivot);
+    __m512i first = _mm512_loadu_si512(arr), last = _mm512_loadu_si512(arr + n - 16);
+    int rl = 16, rr = n - 16;   // unread keys are arr[rl .. rr)
+    int wl = 0, wr = n;         // left part is arr[0 .. wl), right part arr[wr .. n)
+
+    while (rr - rl >= 16) {
+        __m512i v;
+        if (rl - wl <= wr - rr) {
+            v = _mm512_loadu_si512(arr + rl);
+            rl += 16;
+        } else {
+            rr -= 16;
+            v = _mm512_loadu_si512(arr + rr);
+        }
+        __mmask16 m = le ? _mm512_cmple_epi32_mask(v, vp) : _mm512_cmplt_epi32_mask(v, vp);
+        int cnt = __builtin_popcount(m);
+        _mm512_mask_compressstoreu_epi32(arr + wl, m, v);
+        wl += cnt;
+        wr -= 16 - cnt;
+        _mm512_mask_compressstoreu_epi32(arr + wr, (__mmask16)~m, v);
+    }
+
+    int rest[16], nrest = rr - rl;
+    memcpy(rest, arr + rl, (size_t)nrest * sizeof(int));
+    for (int i = 0; i < nrest; i++) {
+        if (le ? rest[i] <= pivot : rest[i] < pivot) arr[wl++] = rest[i];
+        else arr[--wr] = rest[i];
+    }
+
+    __m512i held[2] = {first, last};
+    for (int h = 0; h < 2; h++) {
+        __mmask16 m = le ? _mm512_cmple_epi32_mask(held[h], vp)
+                           : _mm512_cmplt_epi32_mask(held[h], vp);
+        int cnt = __builtin_popcount(m);
+        _mm512_mask_compressstoreu_epi32(arr + wl, m, held[h]);
+        wl += cnt;
+        wr -= 16 - cnt;
+        _mm512_mask_compressstoreu_epi32(arr + wr, (__mmask16)~m, held[h]);
+    }
+    return wl;
+}
+
+// Median of 16 evenly spaced keys, sorted by the network
+__attribute__((target("avx512f")))
+static inline int simd512_pivot(const int *arr, int n) {
+    const __m512i iota = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    int stride = n / 16;
+    __m512i idx = _mm512_add_epi32(_mm512_mullo_epi32(iota, _mm512_set1_epi32(stride)),
+                                   _mm512_set1_epi32(stride / 2));
+    __m512i s = _mm512_i32gather_epi32(idx, arr, 4);
+    simd512_network(&s, 1);
+    int tmp[16];
+    _mm512_storeu_si512(tmp, s);
+    return tmp[8];
+}
+
+// Two sorted registers in, the 16 smallest (sorted) in *a and the 16 largest in *b
+__attribute__((target("avx512f")))
+static inline void simd512_merge16(__m512i *a, __m512i *b) {
+    const __m512i rev = _mm512_set_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i rb = _mm512_permutexvar_epi32(rev, *b);
+    __m512i lo = _mm512_min_epi32(*a, rb), hi = _mm512_max_epi32(*a, rb);
+    for (int j = 8; j > 0; j >>= 1) {
+        lo = simd512_step(lo, j, simd_lanebit[j]);
+        hi = simd512_step(hi, j, simd_lanebit[j]);
+    }
+    *a = lo;
+    *b = hi;
+}
+
+// --- AVX2: 8 lanes -----------------------------------------------------------
+
+__attribute__((target("avx2")))
+static inline __m256i simd256_maskvec(unsigned m) {
+    const __m256i bits = _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)m), bits), bits);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i simd256_step(__m256i v, int j, unsigned takemax) {
+    const __m256i iota = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256i other = _mm256_permutevar8x32_epi32(v, _mm256_xor_si256(iota, _mm256_set1_epi32(j)));
+    return _mm256_blendv_epi8(_mm256_min_epi32(v, other), _mm256_max_epi32(v, other),
+                              simd256_maskvec(takemax));
+}
+
+// Full bitonic sort of the 8*R ints in v[0..R-1] (R = 1, 2, 4 or 8)
+__attribute__((target("avx2")))
+static inline void simd256_network(__m256i *v, int R) {
+    for (int k = 2; k <= 8 * R; k <<= 1) {
+        for (int j = k >> 1; j > 0; j >>= 1) {
+            for (int r = 0; r < R; r++) {
+                if (j >= 8) {
+                    int p = r ^ (j >> 3);
+                    if (p < r || p >= R) continue;
+                    __m256i lo = _mm256_min_epi32(v[r], v[p]), hi = _mm256_max_epi32(v[r], v[p]);
+                    int asc = ((8 * r) & k) == 0;
+                    v[r] = asc ? lo : hi;
+                    v[p] = asc ? hi : lo;
+                } else {
+                    unsigned dir = k < 8 ? simd_lanebit[k] & 0xFF : ((8 * r) & k) ? 0xFF : 0;
+                    v[r] = simd256_step(v[r], j, (simd_lanebit[j] & 0xFF) ^ dir);
+                }
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void simd256_sort_small(int *arr, int n) {
+    __m256i v[8];
+    int R = n <= 8 ? 1 : n <= 16 ? 2 : n <= 32 ? 4 : 8;
+    for (int r = 0; r < R; r++) {
+        int cnt = n - 8 * r < 0 ? 0 : n - 8 * r > 8 ? 8 : n - 8 * r;
+        __m256i m = simd256_maskvec((1u << cnt) - 1);
+        v[r] = _mm256_blendv_epi8(_mm256_set1_epi32(INT_MAX), _mm256_maskload_epi32(arr + 8 * r, m), m);
+    }
+    simd256_network(v, R);
+    for (int r = 0; r < R; r++) {
+        int cnt = n - 8 * r < 0 ? 0 : n - 8 * r > 8 ? 8 : n - 8 * r;
+        _mm256_maskstore_epi32(arr + 8 * r, simd256_maskvec((1u << cnt) - 1), v[r]);
+    }
+}
+
+// Permutation that moves the lanes selected by m to the front (in order) and
+// the others behind them: PEXT packs the selected lane numbers bytewise.
+__attribute__((target("avx2,bmi2")))
+static inline __m256i simd256_compress_perm(unsigned m) {
+    const uint64_t identity = 0x0706050403020100ULL;
+    uint64_t sel = _pdep_u64(m, 0x0101010101010101ULL) * 0xFF;
+    uint64_t left = _pext_u64(identity, sel);
+    uint64_t right = _pext_u64(identity, ~sel);
+    int cnt = __builtin_popcount(m);
+    uint64_t perm = cnt == 8 ? left : left | (right << (8 * cnt));
+    return _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)perm));
+}
+
+// As simd512_partition. Each vector is permuted to [left keys | right keys]
+// and stored twice, at wl and ending at wr; the slack lanes of each store land
+// in free space.
+__attribute__((target("avx2,bmi2")))
+static inline int simd256_partition(int *arr, int n, int pivot, int le) {
+    if (!le && pivot == INT_MIN) return 0;
+    const __m256i vp = _mm256_set1_epi32(le ? pivot : pivot - 1);
+    __m256i first = _mm256_loadu_si256((const __m256i *)arr);
+    __m256i last = _mm256_loadu_si256((const __m256i *)(arr + n - 8));
+    int rl = 8, rr = n - 8;
+    int wl = 0, wr = n;
+
+    // x <= p is !(x > p); x < pivot is x <= pivot - 1
+    while (rr - rl >= 8) {
+        __m256i v;
+        if (rl - wl <= wr - rr) {
+            v = _mm256_loadu_si256((const __m256i *)(arr + rl));
+            rl += 8;
+        } else {
+            rr -= 8;
+            v = _mm256_loadu_si256((const __m256i *)(arr + rr));
+        }
+        unsigned m = ~(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, vp))) & 0xFF;
+        int cnt = __builtin_popcount(m);
+        __m256i pv = _mm256_permutevar8x32_epi32(v, simd256_compress_perm(m));
+        _mm256_storeu_si256((__m256i *)(arr + wl), pv);
+        _mm256_storeu_si256((__m256i *)(arr + wr - 8), pv);
+        wl += cnt;
+        wr -= 8 - cnt;
+    }
+
+    int rest[8], nrest = rr - rl;
+    memcpy(rest, arr + rl, (size_t)nrest * sizeof(int));
+    for (int i = 0; i < nrest; i++) {
+        if (le ? rest[i] <= pivot : rest[i] < pivot) arr[wl++] = rest[i];
+        else arr[--wr] = rest[i];
+    }
+
+    __m256i held[2] = {first, last};
+    for (int h = 0; h < 2; h++) {
+        unsigned m = ~(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(held[h], vp))) & 0xFF;
+        int cnt = __builtin_popcount(m);
+        __m256i pv = _mm256_permutevar8x32_epi32(held[h], simd256_compress_perm(m));
+        _mm256_storeu_si256((__m256i *)(arr + wl), pv);
+        _mm256_storeu_si256((__m256i *)(arr + wr - 8), pv);
+        wl += cnt;
+        wr -= 8 - cnt;
+    }
+    return wl;
+}
+
+__attribute__((target("avx2")))
+static inline int simd256_pivot(const int *arr, int n) {
+    int stride = n / 8;
+    __m256i idx = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0),
+                                                      _mm256_set1_epi32(stride)),
+                                   _mm256_set1_epi32(stride / 2));
+    __m256i s = _mm256_i32gather_epi32(arr, idx, 4);
+    simd256_network(&s, 1);
+    int tmp[8];
+    _mm256_storeu_si256((__m256i *)tmp, s);
+    return tmp[4];
+}
+
+__attribute__((target("avx2")))
+static inline void simd256_merge8(__m256i *a, __m256i *b) {
+    __m256i rb = _mm256_permutevar8x32_epi32(*b, _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i lo = _mm256_min_epi32(*a, rb), hi = _mm256_max_epi32(*a, rb);
+    for (int j = 4; j > 0; j >>= 1) {
+        lo = simd256_step(lo, j, simd_lanebit[j] & 0xFF);
+        hi = simd256_step(hi, j, simd_lanebit[j] & 0xFF);
+    }
+    *a = lo;
+    *b = hi;
+}
+
+// --- Quicksort driver --------------------------------------------------------
+// If no key is below the pivot, the pivot is the minimum: a second pass with
+// <= splits off every copy of it, which is already in final position. Runs of
+// duplicates therefore shrink the range instead of recursing on it.
+
+#define SIMD_QSORT(isa)                                                          \
+static inline void simd##isa##_qsort(int *arr, int n, int depth) {                     \
+    while (n > SIMD_SMALL) {                                                    \
+        if (depth-- == 0) {                                                     \
+            introHeapSortNoCount(arr, 0, n - 1);                                \
+            return;                                                             \
+        }                                                                       \
+        int pivot = simd##isa##_pivot(arr, n);                                  \
+        int k = simd##isa##_partition(arr, n, pivot, 0);                        \
+        if (k == 0) {                                                           \
+            k = simd##isa##_partition(arr, n, pivot, 1);                        \
+            arr += k;                                                           \
+            n -= k;                                                             \
+            continue;                                                           \
+        }                                                                       \
+        if (k < n - k) {                                                        \
+            simd##isa##_qsort(arr, k, depth);                                   \
+            arr += k;                                                           \
+            n -= k;                                                             \
+        } else {                                                                \
+            simd##isa##_qsort(arr + k, n - k, depth);                           \
+            n = k;                                                              \
+        }                                                                       \
+    }                                                                           \
+    simd##isa##_sort_small(arr, n);                                             \
+}
+
+__attribute__((target("avx512f"))) SIMD_QSORT(512)
+__attribute__((target("avx2,bmi2"))) SIMD_QSORT(256)
+
+// --- Vectorized merge --------------------------------------------------------
+// Merges sorted a[0..na) and b[0..nb) into dst. The register holding the
+// largest keys seen so far is merged with the next vector of whichever input
+// has the smaller head; the low half is final (every held key is <= both
+// heads). Once the input with the smaller head has less than a vector left,
+// the held register and both tails finish in a scalar three-way merge.
+
+static inline void simdMergeTail(const int *h, int nh, const int *a, int na,
+                                 const int *b, int nb, int *dst) {
+    int i = 0, j = 0, k = 0;
+    while (i < nh || j < na || k < nb) {
+        int take = 0, best = INT_MAX, have = 0;
+        if (i < nh) { best = h[i]; take = 0; have = 1; }
+        if (j < na && (!have || a[j] < best)) { best = a[j]; take = 1; have = 1; }
+        if (k < nb && (!have || b[k] < best)) { best = b[k]; take = 2; }
+        *dst++ = best;
+        if (take == 0) i++;
+        else if (take == 1) j++;
+        else k++;
+    }
+}
+
+#define SIMD_MERGE(isa, W, vec, load, store, merge)                              \
+static inline void simd##isa##_merge(const int *a, int na, const int *b, int nb, int *dst) { \
+    if (na < W || nb < W) {                                                     \
+        simdMergeTail(a, 0, a, na, b, nb, dst);                                 \
+        return;                                                                 \
+    }                                                                           \
+    vec lo = load(a), hi = load(b);                                             \
+    int ia = W, ib = W;                                                         \
+    for (;;) {                                                                  \
+        merge(&lo, &hi);                                                        \
+        store(dst, lo);                                                         \
+        dst += W;                                                               \
+        int a_next = ia < na && (ib >= nb || a[ia] <= b[ib]);                   \
+        if (a_next && ia + W <= na) {                                           \
+            lo = load(a + ia);                                                  \
+            ia += W;                                                            \
+        } else if (!a_next && ib + W <= nb) {                                   \
+            lo = load(b + ib);                                                  \
+            ib += W;                                                            \
+        } else {                                                                \
+            break;                                                              \
+        }                                                                       \
+    }                                                                           \
+    int held[W];                                                                \
+    store(held, hi);                                                            \
+    simdMergeTail(held, W, a + ia, na - ia, b + ib, nb - ib, dst);              \
+}
+
+#define SIMD512_LOAD(p) _mm512_loadu_si512(p)
+#define SIMD512_STORE(p, v) _mm512_storeu_si512((p), (v))
+#define SIMD256_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define SIMD256_STORE(p, v) _mm256_storeu_si256((__m256i *)(p), (v))
+
+__attribute__((target("avx512f"))) SIMD_MERGE(512, 16, __m512i, SIMD512_LOAD, SIMD512_STORE, simd512_merge16)
+__attribute__((target("avx2"))) SIMD_MERGE(256, 8, __m256i, SIMD256_LOAD, SIMD256_STORE, simd256_merge8)
+
+// --- Dispatch ----------------------------------------------------------------
+
+typedef struct {
+    cpu_impl impl;
+    simdsort_impl_t kind;
+} simdsort_kernel;
+
+static const simdsort_kernel simdsort_kernels[] = {
+    {{"avx512", CPU_AVX512F, 0}, SIMDSORT_AVX512},
+    {{"avx2", CPU_AVX2 | CPU_BMI2, 0}, SIMDSORT_AVX2},
+    {{"scalar", 0, 0}, SIMDSORT_SCALAR},
+};
+
+// Sorts 1000 pseudo-random keys (with duplicates, INT_MIN and INT_MAX) with
+// the quicksort and merges two sorted runs of them, checking both results
+// against the scalar introsort
+static inline int simdsortKernelSelfTest(int i) {
+    enum { N = 1000 };
+    int a[N], want[N], merged[N];
+    uint32_t x = 12345;
+    for (int k = 0; k < N; k++) {
+        x = x * 1103515245u + 12345u;
+        a[k] = (int)(x >> 8) % 500 - 250;
+    }
+    a[7] = INT_MIN;
+    a[500] = INT_MAX;
+    memcpy(want, a, sizeof(a));
+    introSortNoCount(want, 0, N - 1);
+
+    simdsort_impl_t kind = simdsort_kernels[i].kind;
+    int depth = 2 * 10;
+    if (kind == SIMDSORT_AVX512) simd512_qsort(a, N, depth);
+    else if (kind == SIMDSORT_AVX2) simd256_qsort(a, N, depth);
+    else introSortNoCount(a, 0, N - 1);
+    if (memcmp(a, want, sizeof(a)) != 0) return 0;
+    if (kind == SIMDSORT_SCALAR) return 1;
+
+    // Two interleaved sorted runs: the evens and the odds of want
+    int runs[N];
+    for (int k = 0; k < N / 2; k++) {
+        runs[k] = want[2 * k];
+        runs[N / 2 + k] = want[2 * k + 1];
+    }
+    if (kind == SIMDSORT_AVX512) simd512_merge(runs, N / 2, runs + N / 2, N / 2, merged);
+    else simd256_merge(runs, N / 2, runs + N / 2, N / 2, merged);
+    return memcmp(merged, want, sizeof(want)) == 0;
+}
+
+// Detected once per process; the race on first use is benign (same answer).
+static int simdsort_cached = -1;
+
+static inline simdsort_impl_t simdsort_impl(void) {
+    int k = __atomic_load_n(&simdsort_cached, __ATOMIC_RELAXED);
+    if (k < 0) {
+        k = CPU_SELECT("SIMDSORT_IMPL", simdsort_kernels, simdsortKernelSelfTest);
+        __atomic_store_n(&simdsort_cached, k, __ATOMIC_RELAXED);
+    }
+    return simdsort_kernels[k].kind;
+}
+
+// --- Entry points ------------------------------------------------------------
+
+// Sorts arr[0..n-1] in place.
+static inline void simdSort(int arr[], int n) {
+    int depth = 0;
+    for (int m = n; m > 1; m >>= 1) depth += 2;
+    switch (simdsort_impl()) {
+    case SIMDSORT_AVX512: simd512_qsort(arr, n, depth); break;
+    case SIMDSORT_AVX2:   simd256_qsort(arr, n, depth); break;
+    default:              introSortNoCount(arr, 0, n - 1); break;
+    }
+}
+
+// Sorts arr[0..n-1] with one auxiliary buffer of n ints (caller-provided, or
+// allocated for the call when buf is NULL). Returns 0, or -1 if allocation fails.
+static inline int simdMergeSort(int arr[], int n, int buf[]) {
+    simdsort_impl_t impl = simdsort_impl();
+    if (impl == SIMDSORT_SCALAR) return bottomUpMergeSortNoCount(arr, n, buf);
+    if (n < 2) return 0;
+
+    int *own = NULL;
+    if (buf == NULL) {
+        own = malloc((size_t)n * sizeof(int));
+        if (own == NULL) return -1;
+        buf = own;
+    }
+    for (int low = 0; low < n; low += SIMD_SMALL) {
+        int len = n - low < SIMD_SMALL ? n - low : SIMD_SMALL;
+        if (impl == SIMDSORT_AVX512) simd512_sort_small(arr + low, len);
+        else simd256_sort_small(arr + low, len);
+    }
+
+    int *src = arr, *dst = buf;
+    for (int width = SIMD_SMALL; width < n; width *= 2) {
+        for (int low = 0; low < n; low += 2 * width) {
+            int mid = low + width < n ? low + width : n;
+            int high = low + 2 * width < n ? low + 2 * width : n;
+            if (mid == high || src[mid - 1] <= src[mid])
+                memcpy(dst + low, src + low, (size_t)(high - low) * sizeof(int));
+            else if (impl == SIMDSORT_AVX512)
+                simd512_merge(src + low, mid - low, src + mid, high - mid, dst + low);
+            else
+                simd256_merge(src + low, mid - low, src + mid, high - mid, dst + low);
+        }
+        int *t = src; src = dst; dst = t;
+    }
+    if (src != arr) memcpy(arr, src, (size_t)n * sizeof(int));
+
+    free(own);
+    return 0;
+}
+
+#endif // SIMDSORT_H
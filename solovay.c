@@ -6,6 +6,10 @@
 #include <gmp.h>
 #include <x86intrin.h> // for __rdtsc and __rdtscp
 
+#include "gmparena.h"
+#include "primality.h"
+#include "multiexp.h"
+
 /* ----------------------------- Tunable params ----------------------------- */
 /* Number of Solovay–Strassen rounds (higher => smaller error prob). */
 #define SS_ROUNDS 64
@@ -16,14 +20,11 @@
 /* How many iterations to benchmark */
 #define RUNS 10000
 
-/* ----------------------------- Small primes ------------------------------- */
-/* Quick trial division by a handful of small primes makes testing faster. */
-static const unsigned small_primes[] = {
-    3, 5, 7, 11, 13, 17, 19, 23, 29, 31,
-    37, 41, 43, 47, 53, 59, 61, 67, 71, 73,
-    79, 83, 89, 97, 101, 103, 107, 109, 113
-};
-static const size_t small_primes_count = sizeof(small_primes)/sizeof(small_primes[0]);
+/* Iterations per configuration in the SS vs BPSW comparison */
+#define COMPARE_RUNS 200
+
+/* Largest prime generated (the comparison's top size) */
+#define COMPARE_MAX_BITS 1024
 
 /* ------------------------------ rdtsc helpers ------------------------------ */
 /* Use __rdtsc / __rdtscp and cpuid for serialization.
@@ -59,101 +60,141 @@ static void init_rng(gmp_randstate_t st) {
     mpz_clear(s);
 }
 
-/* --------------------- 512-bit odd candidate generation ------------------- */
-/* Generate a random 512-bit integer with MSB=1 (exact size) and LSB=1 (odd). */
-static void random_odd_candidate_512(mpz_t n, gmp_randstate_t st) {
-    mpz_urandomb(n, st, PRIME_BITS); /* n in [0, 2^512 - 1] */
-    mpz_setbit(n, PRIME_BITS - 1); /* Ensure MSB=1 => exactly 512 bits */
+/* ----------------------- odd candidate generation ------------------------ */
+/* Generate a random 'bits'-bit integer with MSB=1 (exact size) and LSB=1 (odd). */
+static void random_odd_candidate(mpz_t n, unsigned bits, gmp_randstate_t st) {
+    mpz_urandomb(n, st, bits); /* n in [0, 2^bits - 1] */
+    mpz_setbit(n, bits - 1); /* Ensure MSB=1 => exactly 'bits' bits */
     mpz_setbit(n, 0); /* Ensure odd */
 }
 
-/* -------------------------- Small-prime screening ------------------------- */
-/* Quickly reject numbers divisible by any small prime. */
-static int divisible_by_small_prime(const mpz_t n) {
-    if (mpz_cmp_ui(n, 2) < 0) return 1; /* n < 2: treat as composite for our purpose */
-    if (mpz_cmp_ui(n, 2) == 0) return 0; /* 2 is prime (won't occur because we force odd) */
-    if (mpz_even_p(n)) return 1; /* even => composite */
-
-    for (size_t i = 0; i < small_primes_count; ++i) {
-        unsigned p = small_primes[i];
-        unsigned long rem = mpz_fdiv_ui(n, p);
-        if (rem == 0) return 1; /* divisible => composite */
-    }
-    return 0; /* passed quick screen */
-}
-
 /* ---------------------- Solovay–Strassen primality ------------------------ */
 /*
    Return 1 if n is a probable prime by k rounds of Solovay–Strassen, else 0.
+   Values below 2^64 are decided exactly by the native Miller–Rabin path.
+   The rounds run on the caller's primality context (re-bound to n here), which
+   holds n-1, n-3, (n-1)/2 and the Montgomery setup, so no round allocates.
+   The first round runs alone since it rejects almost every composite; the
+   remaining k-1 rounds share the exponent (n-1)/2 and run MEXP_LANES bases
+   per pass of the multi-lane exponentiation.
 */
-static int is_probable_prime_ss(const mpz_t n, int k, gmp_randstate_t st) {
-    if (mpz_cmp_ui(n, 2) < 0) return 0;
-    if (mpz_cmp_ui(n, 2) == 0) return 1;
+static int is_probable_prime_ss(prime_ctx *ctx, mexp_ctx *mc, const mpz_t n, int k,
+                                gmp_randstate_t st) {
+    int small_result;
+    if (prime64_dispatch(n, &small_result)) return small_result;
     if (mpz_even_p(n)) return 0;
 
-    mpz_t a, g, exp, p, jac_mod, n_minus_1, n_minus_3;
-    mpz_inits(a, g, exp, p, jac_mod, n_minus_1, n_minus_3, NULL);
-
-    mpz_sub_ui(n_minus_1, n, 1); /* n - 1 */
-    mpz_sub_ui(n_minus_3, n, 3); /* n - 3 (upper bound for a) */
-
-    for (int i = 0; i < k; ++i) {
-        /* a ∈ [2, n-2] -> create uniform a in [0, n-4], then add 2 */
-        mpz_urandomm(a, st, n_minus_3); /* [0, n-4] */
-        mpz_add_ui(a, a, 2); /* [2, n-2] */
+    prime_ctx_set(ctx, n);
 
-        /* g = gcd(a, n) > 1 => composite */
-        mpz_gcd(g, a, n);
-        if (mpz_cmp_ui(g, 1) != 0) {
-            mpz_clears(a,g,exp,p,jac_mod,n_minus_1,n_minus_3,NULL);
-            return 0;
-        }
+    /* a ∈ [2, n-2]; gcd(a, n) > 1, Jacobi(a, n) = 0 or
+       a^((n-1)/2) != Jacobi(a, n) => composite */
+    prime_ctx_random_base(ctx, st);
+    if (k > 0 && !prime_ctx_ss_round(ctx, ctx->a)) return 0;
 
-        /* jac = Jacobi(a, n) (GMP provides this as an int) */
-        int jac = mpz_jacobi(a, n);
-        if (jac == 0) {
-            mpz_clears(a,g,exp,p,jac_mod,n_minus_1,n_minus_3,NULL);
-            return 0;
+    mexp_set(mc, n, ctx->half);
+    for (int i = 1; i < k; i += MEXP_LANES) {
+        int count = k - i < MEXP_LANES ? k - i : MEXP_LANES;
+        for (int l = 0; l < count; ++l) {
+            prime_ctx_random_base(ctx, st);
+            mpz_set(mc->a[l], ctx->a);
         }
+        if (mexp_ss_rounds(ctx, mc, (const mpz_t *)mc->a, count, NULL) != count) return 0;
+    }
+    return 1; /* Passed all rounds => probable prime */
+}
 
-        /* p = a^((n-1)/2) mod n */
-        mpz_set(exp, n_minus_1);
-        mpz_fdiv_q_2exp(exp, exp, 1); /* exp = (n-1)/2 */
-        mpz_powm(p, a, exp, n);
+/* ---------------------------- prime generator ----------------------------- */
+/* Everything generate_prime works in, built once by main and reused for every
+   prime: the primality and multi-lane exponentiation contexts (sized for the
+   largest prime wanted; they re-bind to each candidate), the remainder-tree
+   screen, whose primorial product tree alone costs ~600K cycles to build,
+   and the candidate batch. */
+typedef struct {
+    prime_ctx ctx;
+    mexp_ctx mc;
+    screen_ctx sc;
+    mpz_t cand[SCREEN_BATCH];
+    uint8_t survive[SCREEN_BATCH];
+} prime_gen;
+
+static void prime_gen_init(prime_gen *g, unsigned max_bits) {
+    prime_ctx_init(&g->ctx, max_bits);
+    mexp_init(&g->mc, max_bits);
+    screen_init(&g->sc, SCREEN_BATCH);
+    for (int i = 0; i < SCREEN_BATCH; ++i) mpz_init2(g->cand[i], max_bits);
+}
 
-        /* Convert jac to residue mod n: -1 -> n-1, +1 -> 1 */
-        if (jac == -1) {
-            mpz_sub_ui(jac_mod, n, 1);
-        } else {
-            mpz_set_ui(jac_mod, 1);
-        }
+static void prime_gen_clear(prime_gen *g) {
+    for (int i = 0; i < SCREEN_BATCH; ++i) mpz_clear(g->cand[i]);
+    screen_clear(&g->sc);
+    mexp_clear(&g->mc);
+    prime_ctx_clear(&g->ctx);
+}
 
-        /* If p != jac_mod (mod n), n is composite */
-        if (mpz_cmp(p, jac_mod) != 0) {
-            mpz_clears(a,g,exp,p,jac_mod,n_minus_1,n_minus_3,NULL);
-            return 0;
+/* Draw SCREEN_BATCH random 'bits'-bit odd candidates at a time until one passes:
+   1) batch screen against every prime up to SCREEN_BOUND (remainder tree)
+   2) SS_ROUNDS rounds of Solovay–Strassen (PRIME_TEST_DEFAULT)
+      or one Baillie–PSW test (PRIME_TEST_BPSW)
+   Survivors are tested in draw order. A whole batch is drawn from st before
+   any base is, and the Solovay–Strassen bases come from the same stream, so
+   the prime for a given seed differs from one-at-a-time generation.
+   bits must not exceed the max_bits g was built for.
+*/
+static void generate_prime(prime_gen *g, mpz_t prime, unsigned bits, prime_test_t test,
+                           gmp_randstate_t st) {
+    int found = 0;
+
+    while (!found) {
+        for (int i = 0; i < SCREEN_BATCH; ++i) random_odd_candidate(g->cand[i], bits, st);
+        screen_batch(&g->sc, (const mpz_t *)g->cand, SCREEN_BATCH, g->survive);
+        for (int i = 0; i < SCREEN_BATCH && !found; ++i) {
+            if (!g->survive[i]) continue;
+            if (test == PRIME_TEST_BPSW)
+                found = is_probable_prime_bpsw(g->cand[i]);
+            else
+                found = is_probable_prime_ss(&g->ctx, &g->mc, g->cand[i], SS_ROUNDS, st);
+            if (found) mpz_set(prime, g->cand[i]); /* found probable prime */
         }
     }
+}
 
-    mpz_clears(a,g,exp,p,jac_mod,n_minus_1,n_minus_3,NULL);
-    return 1; /* Passed all rounds => probable prime */
+static void generate_prime_512(prime_gen *g, mpz_t prime, gmp_randstate_t st) {
+    generate_prime(g, prime, PRIME_BITS, PRIME_TEST_DEFAULT, st);
 }
 
-/* ------------------------- 512-bit prime generator ------------------------ */
-/* Keep drawing random 512-bit odd candidates until one passes:
-   1) small-prime screen
-   2) SS_ROUNDS rounds of Solovay–Strassen
-*/
-static void generate_prime_512(mpz_t prime, gmp_randstate_t st) {
-    for (;;) {
-        random_odd_candidate_512(prime, st);
-        if (divisible_by_small_prime(prime)) continue;
-        if (is_probable_prime_ss(prime, SS_ROUNDS, st)) return; /* found probable prime */
+/* ------------------------ SS vs BPSW comparison --------------------------- */
+/* Average cycles per generated prime for each test at 512 and 1024 bits.
+   g must be built for COMPARE_MAX_BITS. */
+static void compare_prime_tests(prime_gen *g, gmp_randstate_t st) {
+    static const unsigned sizes[] = {512, 1024};
+    static const prime_test_t tests[] = {PRIME_TEST_DEFAULT, PRIME_TEST_BPSW};
+    static const char *names[] = {"Solovay-Strassen x64", "Baillie-PSW"};
+    mpz_t prime;
+    mpz_init(prime);
+
+    printf("\nCycles per generated prime (%d runs each):\n", COMPARE_RUNS);
+    for (size_t b = 0; b < sizeof(sizes)/sizeof(sizes[0]); ++b) {
+        for (size_t t = 0; t < sizeof(tests)/sizeof(tests[0]); ++t) {
+            uint64_t total = 0;
+            for (int i = 0; i < COMPARE_RUNS; ++i) {
+                uint64_t start = rdtsc_start();
+                generate_prime(g, prime, sizes[b], tests[t], st);
+                uint64_t end = rdtsc_end();
+                total += end - start;
+            }
+            printf("  %4u-bit  %-22s avg cycles: %.2f\n", sizes[b], names[t],
+                   (double)total / (double)COMPARE_RUNS);
+        }
     }
+
+    mpz_clear(prime);
 }
 
 /* ---------------------------------- main ---------------------------------- */
 int main(void) {
+    /* Pool GMP allocations (GMP_ARENA=off for plain malloc); before any mpz */
+    gmp_arena_install(GMP_ARENA_POOL);
+
     /* Initialize RNG (Mersenne Twister in GMP) */
     gmp_randstate_t st;
     init_rng(st);
@@ -161,6 +202,10 @@ int main(void) {
     mpz_t prime;
     mpz_init(prime);
 
+    /* Contexts shared by every prime generation below */
+    prime_gen gen;
+    prime_gen_init(&gen, COMPARE_MAX_BITS);
+
     uint64_t total = 0;
     uint64_t min_cycles = (uint64_t)-1; /* initialize to max */
     uint64_t max_cycles = 0;
@@ -168,7 +213,7 @@ int main(void) {
     /* Run the benchmark RUNS times */
     for (int i = 0; i < RUNS; ++i) {
         uint64_t start = rdtsc_start();
-        generate_prime_512(prime, st);
+        generate_prime_512(&gen, prime, st);
         uint64_t end = rdtsc_end();
 
         uint64_t cycles = end - start;
@@ -184,7 +229,8 @@ int main(void) {
 
     double avg = (double)total / (double)RUNS;
 
-    printf("Ran %d prime generations (512-bit, Solovay-Strassen).\n", RUNS);
+    printf("Ran %d prime generations (512-bit, Solovay-Strassen, %s exponentiation).\n",
+           RUNS, mexp_impl_name(mexp_detect()));
     printf("Min cycles : %llu\n", (unsigned long long)min_cycles);
     printf("Max cycles : %llu\n", (unsigned long long)max_cycles);
     printf("Avg cycles : %.2f\n", avg);
@@ -192,7 +238,12 @@ int main(void) {
     /* Optionally show the last generated prime (hex) */
     gmp_printf("Last generated prime (hex):\n%Zx\n", prime);
 
+    compare_prime_tests(&gen, st);
+
+    prime_gen_clear(&gen);
     mpz_clear(prime);
     gmp_randclear(st);
+    gmp_arena_report(stdout);
+    gmp_arena_release();
     return 0;
 }
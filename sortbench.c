@@ -0,0 +1,504 @@
+// sortbench.c
+// Benchmark driver for the sorting kernels at realistic sizes.
+// Sweeps n = 1, 2, 5 x 10^k from 10^3 up to max_n over ten input
+// distributions (uniform, sorted, reversed, nearly-sorted, few-unique, Zipf,
+// organ-pipe, and presorted-P for P = 50, 90, 99: P% of the keys in sorted
+// position, the rest random, like an appended log). Every trial generates one input and runs each algorithm on a
+// copy of it; trials are spread over worker threads, each with its own input,
+// work and scratch buffers (allocated once, grown only when n outgrows them)
+// and its own comparison/swap counters (thread-local, see sorting.h).
+//
+// Per run it records comparisons, swaps, wall time, TSC cycles and, where the
+// kernel allows perf_event_open, the thread's cache misses and branch misses
+// (left empty in the CSV otherwise). QuickSort and MergeSort also run in their
+// NoCount instantiation, which shows what the counters cost. Results:
+//   sortbench_results.csv  - every (distribution, size, algorithm): min,
+//                            median and max over the trials
+//   sorting_max_data.csv, sorting_min_data.csv, sorting_median_data.csv
+//                          - the uniform distribution in the layout read by
+//                            sorting_max.py / sorting_min.py / Sorting_median.py,
+//                            plus per-algorithm Seconds columns (the same
+//                            columns as maxcomparison.c's sorting_max_data.csv)
+// Trials sharing the machine also share caches and memory bandwidth: use one
+// thread for the cleanest timings, more to get the counts sooner.
+//
+// Build: gcc -O2 -pthread sortbench.c -lm
+// Usage: ./a.out [max_n] [threads] [seed]   (default 10^8, all online CPUs;
+//        workers per size are capped so their buffers fit in half of RAM)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "sorting.h"
+#include "stats.h"
+#include "benchutil.h"
+#include "radixsort.h"
+#include "simdsort.h"
+
+#define BUBBLE_MAX 10000    // O(n^2): larger sizes are skipped
+#define ZIPF_KEYS (1 << 16) // distinct Zipf keys
+#define ZIPF_S 1.0
+#define FEW_UNIQUE 16       // distinct keys of the few-unique distribution
+
+// --- Algorithms --------------------------------------------------------------
+
+// Each returns its passes over the data for the radix sorts, 0 otherwise
+static int run_quick(int *a, int n, int *buf) { (void)buf; introSort(a, 0, n - 1); return 0; }
+static int run_merge(int *a, int n, int *buf) { bottomUpMergeSort(a, n, buf); return 0; }
+static int run_bubble(int *a, int n, int *buf) { (void)buf; bubbleSort(a, n); return 0; }
+static int run_heap(int *a, int n, int *buf) { (void)buf; heapSort(a, n); return 0; }
+static int run_heap4(int *a, int n, int *buf) { (void)buf; heapSort4(a, n); return 0; }
+static int run_heap8(int *a, int n, int *buf) { (void)buf; heapSort8(a, n); return 0; }
+static int run_power(int *a, int n, int *buf) { powerSort(a, n, buf); return 0; }
+static int run_lsd(int *a, int n, int *buf) { return lsdRadixSort(a, n, buf); }
+static int run_msd(int *a, int n, int *buf) { return msdRadixSort(a, n, buf); }
+static int run_simd(int *a, int n, int *buf) { (void)buf; simdSort(a, n); return 0; }
+static int run_quick_nc(int *a, int n, int *buf) { (void)buf; introSortNoCount(a, 0, n - 1); return 0; }
+static int run_merge_nc(int *a, int n, int *buf) { bottomUpMergeSortNoCount(a, n, buf); return 0; }
+
+typedef struct {
+    const char *name; // CSV column prefix
+    int (*run)(int *arr, int n, int *buf);
+    long max_n;
+} bench_alg;
+
+static const bench_alg algs[] = {
+    {"QuickSort", run_quick, 0},
+    {"MergeSort", run_merge, 0},
+    {"BubbleSort", run_bubble, BUBBLE_MAX},
+    {"HeapSort", run_heap, 0},
+    {"RadixSort", run_lsd, 0},
+    {"MsdRadixSort", run_msd, 0},
+    {"SimdSort", run_simd, 0},
+    // Uncounted instantiations: the time the counters themselves cost
+    {"QuickSortNoCount", run_quick_nc, 0},
+    {"MergeSortNoCount", run_merge_nc, 0},
+    {"HeapSort4", run_heap4, 0},
+    {"HeapSort8", run_heap8, 0},
+    {"PowerSort", run_power, 0},
+};
+#define NALGS (int)(sizeof(algs) / sizeof(algs[0]))
+enum { ALG_QUICK, ALG_MERGE, ALG_BUBBLE, ALG_HEAP, ALG_RADIX, ALG_MSD, ALG_SIMD, ALG_QUICK_NC, ALG_MERGE_NC,
+       ALG_HEAP4, ALG_HEAP8, ALG_POWER };
+
+static int alg_runs(int a, long n) { return algs[a].max_n == 0 || n <= algs[a].max_n; }
+
+// --- Input distributions -----------------------------------------------------
+
+static double zipf_cdf[ZIPF_KEYS]; // built once by main, then read-only
+
+static void zipf_init(void) {
+    double sum = 0;
+    for (int k = 0; k < ZIPF_KEYS; k++) zipf_cdf[k] = sum += 1.0 / pow(k + 1, ZIPF_S);
+    for (int k = 0; k < ZIPF_KEYS; k++) zipf_cdf[k] /= sum;
+}
+
+static int zipf_draw(uint64_t *s) {
+    double u = (double)(splitmix64_next(s) >> 11) * 0x1p-53;
+    int lo = 0, hi = ZIPF_KEYS - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (zipf_cdf[mid] < u) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static const char *dist_names[] = {"uniform", "sorted", "reversed", "nearly-sorted",
+                                   "few-unique", "zipf", "organ-pipe",
+                                   "presorted-50", "presorted-90", "presorted-99"};
+static const int presorted_pct[] = {50, 90, 99};
+#define NDISTS (int)(sizeof(dist_names) / sizeof(dist_names[0]))
+enum { DIST_UNIFORM, DIST_SORTED, DIST_REVERSED, DIST_NEARLY, DIST_FEW, DIST_ZIPF, DIST_ORGAN,
+       DIST_PRESORTED };
+
+static void generate(int *arr, int n, int dist, uint64_t seed) {
+    uint64_t s = seed;
+    switch (dist) {
+    case DIST_UNIFORM:
+        for (int i = 0; i < n; i++) arr[i] = (int)(uint32_t)splitmix64_next(&s);
+        break;
+    case DIST_SORTED:
+        for (int i = 0; i < n; i++) arr[i] = i;
+        break;
+    case DIST_REVERSED:
+        for (int i = 0; i < n; i++) arr[i] = n - i;
+        break;
+    case DIST_NEARLY: // sorted, then 1% of the positions swapped at random
+        for (int i = 0; i < n; i++) arr[i] = i;
+        for (int k = n / 100 > 0 ? n / 100 : 1; k > 0; k--) {
+            int i = (int)(splitmix64_next(&s) % (uint64_t)n), j = (int)(splitmix64_next(&s) % (uint64_t)n);
+            int t = arr[i]; arr[i] = arr[j]; arr[j] = t;
+        }
+        break;
+    case DIST_FEW:
+        for (int i = 0; i < n; i++) arr[i] = (int)(splitmix64_next(&s) % FEW_UNIQUE) * 1000003;
+        break;
+    case DIST_ZIPF:
+        for (int i = 0; i < n; i++) arr[i] = zipf_draw(&s);
+        break;
+    case DIST_ORGAN:
+        for (int i = 0; i < n; i++) arr[i] = i < n / 2 ? i : n - 1 - i;
+        break;
+    default: { // presorted-P
+        uint64_t keep = (uint64_t)presorted_pct[dist - DIST_PRESORTED];
+        for (int i = 0; i < n; i++) {
+            uint64_t r = splitmix64_next(&s);
+            arr[i] = r % 100 < keep ? i : (int)((r >> 32) % (uint64_t)n);
+        }
+        break;
+    }
+    }
+}
+
+// Trials per size: many at small n, where runs are short and noisy
+static int trials_for(long n) {
+    if (n <= 10000) return 21;
+    if (n <= 100000) return 11;
+    if (n <= 1000000) return 7;
+    if (n <= 10000000) return 5;
+    return 3;
+}
+
+// --- Timing and hardware counters --------------------------------------------
+
+// Cache misses and branch misses of the calling thread, as one perf group.
+// fd < 0 when perf_event_open is unavailable (no PMU, or perf_event_paranoid).
+typedef struct {
+    int fd;        // group leader (cache misses)
+    int branch_fd; // member (branch misses)
+} perf_group;
+
+static int perf_open(int config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = (uint64_t)config;
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static void perf_group_open(perf_group *pg) {
+    pg->fd = perf_open(PERF_COUNT_HW_CACHE_MISSES, -1);
+    if (pg->fd < 0) return;
+    pg->branch_fd = perf_open(PERF_COUNT_HW_BRANCH_MISSES, pg->fd);
+    if (pg->branch_fd < 0) {
+        close(pg->fd);
+        pg->fd = -1;
+    }
+}
+
+static void perf_group_close(perf_group *pg) {
+    if (pg->fd < 0) return;
+    close(pg->branch_fd);
+    close(pg->fd);
+}
+
+static void perf_group_start(perf_group *pg) {
+    if (pg->fd < 0) return;
+    ioctl(pg->fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(pg->fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// Stops the group and reads {cache misses, branch misses}; -1 if unavailable.
+static void perf_group_stop(perf_group *pg, long long out[2]) {
+    uint64_t buf[3];
+    out[0] = out[1] = -1;
+    if (pg->fd < 0) return;
+    ioctl(pg->fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(pg->fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf) && buf[0] == 2) {
+        out[0] = (long long)buf[1];
+        out[1] = (long long)buf[2];
+    }
+}
+
+// --- Trials ------------------------------------------------------------------
+
+typedef struct {
+    unsigned long long comparisons, swaps;
+    int passes;
+    double seconds;
+    long long cycles, cache_misses, branch_misses;
+} run_result;
+
+typedef struct {
+    int n, dist;
+    int trials;
+    uint64_t seed;
+    run_result *results; // [trial][alg]
+    int next_trial;      // claimed with __atomic_fetch_add
+    int failed;
+} size_job;
+
+typedef struct {
+    size_job *job;
+    int *input, *work, *scratch;
+    long cap;
+    perf_group perf;
+    int perf_ok; // perf_event_open worked on this worker
+} bench_worker;
+
+static long long key_sum(const int arr[], int n) {
+    long long s = 0;
+    for (int i = 0; i < n; i++) s += arr[i];
+    return s;
+}
+
+static void run_trial(bench_worker *w, int trial) {
+    size_job *job = w->job;
+    int n = job->n;
+    generate(w->input, n, job->dist, job->seed ^ (0x100000001b3ULL * (uint64_t)(trial + 1)));
+    long long sum = key_sum(w->input, n);
+
+    for (int a = 0; a < NALGS; a++) {
+        if (!alg_runs(a, n)) continue;
+        run_result *r = &job->results[(size_t)trial * NALGS + a];
+        long long misses[2];
+        memcpy(w->work, w->input, (size_t)n * sizeof(int));
+
+        comparisons = 0; swaps = 0;
+        perf_group_start(&w->perf);
+        double t0 = now_seconds();
+        uint64_t c0 = read_tsc();
+        int passes = algs[a].run(w->work, n, w->scratch);
+        uint64_t c1 = read_tsc();
+        double t1 = now_seconds();
+        perf_group_stop(&w->perf, misses);
+
+        r->comparisons = comparisons;
+        r->swaps = swaps;
+        r->passes = passes;
+        r->seconds = t1 - t0;
+        r->cycles = (long long)(c1 - c0);
+        r->cache_misses = misses[0];
+        r->branch_misses = misses[1];
+        if (!is_sorted(w->work, n) || key_sum(w->work, n) != sum) {
+            fprintf(stderr, "%s produced wrong output (%s, n = %d)\n",
+                    algs[a].name, dist_names[job->dist], n);
+            __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void *bench_worker_main(void *arg) {
+    bench_worker *w = arg;
+    // perf counts the thread that opened the group, so each worker thread
+    // opens its own
+    perf_group_open(&w->perf);
+    if (w->perf.fd >= 0) w->perf_ok = 1;
+    for (;;) {
+        int t = __atomic_fetch_add(&w->job->next_trial, 1, __ATOMIC_RELAXED);
+        if (t >= w->job->trials) break;
+        run_trial(w, t);
+    }
+    perf_group_close(&w->perf);
+    return NULL;
+}
+
+// Grows the worker's buffers to n ints; they are reused for every smaller size.
+static int worker_reserve(bench_worker *w, long n) {
+    if (n <= w->cap) return 0;
+    free(w->input);
+    free(w->work);
+    free(w->scratch);
+    w->input = malloc((size_t)n * sizeof(int));
+    w->work = malloc((size_t)n * sizeof(int));
+    w->scratch = malloc((size_t)n * sizeof(int));
+    w->cap = n;
+    if (w->input == NULL || w->work == NULL || w->scratch == NULL) {
+        w->cap = 0;
+        return -1;
+    }
+    return 0;
+}
+
+// --- Aggregation and output --------------------------------------------------
+
+// Order statistics over the trials of one algorithm: [0] min, [1] median, [2] max
+typedef struct {
+    double comparisons[3], swaps[3], passes[3], seconds[3], cycles[3], cache_misses[3], branch_misses[3];
+} alg_stats;
+
+// Min, median and max of v[0..k-1] (non-negative, or all -1 for a missing
+// counter), scaled back by 1/scale
+static void order_stats(const double *v, int k, double scale, double out[3]) {
+    if (v[0] < 0) {
+        out[0] = out[1] = out[2] = -1;
+        return;
+    }
+    qstat q;
+    qstat_init(&q);
+    for (int t = 0; t < k; t++) qstat_add(&q, (uint64_t)llround(v[t] * scale));
+    out[0] = (double)q.min / scale;
+    out[1] = (double)qstat_median(&q) / scale;
+    out[2] = (double)q.max / scale;
+    qstat_clear(&q);
+}
+
+static void summarize(const size_job *job, int a, alg_stats *st) {
+    double *v = malloc((size_t)job->trials * sizeof(double));
+    int k = job->trials;
+    // Seconds are summarized as whole nanoseconds
+#define STAT(field, scale)                                                     \
+    for (int t = 0; t < k; t++) v[t] = (double)job->results[(size_t)t * NALGS + a].field; \
+    order_stats(v, k, scale, st->field);
+    STAT(comparisons, 1) STAT(swaps, 1) STAT(passes, 1) STAT(seconds, 1e9) STAT(cycles, 1)
+    STAT(cache_misses, 1) STAT(branch_misses, 1)
+#undef STAT
+    free(v);
+}
+
+// Hardware counters print as empty fields when perf was unavailable
+static void print_counter(FILE *fp, double v) {
+    if (v < 0) fprintf(fp, ",");
+    else fprintf(fp, ",%.0f", v);
+}
+
+static const char *wide_files[3] = {"sorting_min_data.csv", "sorting_median_data.csv",
+                                    "sorting_max_data.csv"};
+static const int wide_algs[] = {ALG_QUICK, ALG_MERGE, ALG_BUBBLE, ALG_HEAP};
+static const int wide_timed[] = {ALG_QUICK, ALG_MERGE, ALG_BUBBLE, ALG_HEAP, ALG_RADIX, ALG_SIMD};
+
+static void wide_header(FILE *fp) {
+    fprintf(fp, "ArraySize");
+    for (int i = 0; i < 4; i++) fprintf(fp, ",%sComp,%sSwaps", algs[wide_algs[i]].name, algs[wide_algs[i]].name);
+    fprintf(fp, ",RadixSortPasses,RadixSortMoves,PowerSortComp,PowerSortSwaps");
+    for (int i = 0; i < 6; i++) fprintf(fp, ",%sSeconds", algs[wide_timed[i]].name);
+    fprintf(fp, "\n");
+}
+
+// One row of sorting_{min,median,max}_data.csv; 'which' indexes the order stats
+static void wide_row(FILE *fp, long n, const alg_stats *st, int which) {
+    fprintf(fp, "%ld", n);
+    for (int i = 0; i < 4; i++) {
+        int a = wide_algs[i];
+        if (alg_runs(a, n)) fprintf(fp, ",%.0f,%.0f", st[a].comparisons[which], st[a].swaps[which]);
+        else fprintf(fp, ",,");
+    }
+    fprintf(fp, ",%.0f,%.0f", st[ALG_RADIX].passes[which], st[ALG_RADIX].swaps[which]);
+    fprintf(fp, ",%.0f,%.0f", st[ALG_POWER].comparisons[which], st[ALG_POWER].swaps[which]);
+    for (int i = 0; i < 6; i++) {
+        int a = wide_timed[i];
+        if (alg_runs(a, n)) fprintf(fp, ",%.6f", st[a].seconds[which]);
+        else fprintf(fp, ",");
+    }
+    fprintf(fp, "\n");
+}
+
+int main(int argc, char **argv) {
+    long max_n = argc > 1 ? strtol(argv[1], NULL, 10) : 100000000L;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned threads = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 10) : (unsigned)(ncpu > 0 ? ncpu : 1);
+    uint64_t seed = argc > 3 ? (uint64_t)strtoull(argv[3], NULL, 0) : (uint64_t)time(NULL);
+    if (max_n < 1000 || max_n > 1000000000L || threads == 0) {
+        fprintf(stderr, "usage: %s [max_n in 10^3..10^9] [threads] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    // Three buffers of n ints per worker, within half of physical memory
+    long pages = sysconf(_SC_PHYS_PAGES), page = sysconf(_SC_PAGESIZE);
+    double budget = pages > 0 && page > 0 ? (double)pages * (double)page / 2 : 4e9;
+
+    FILE *fp = fopen("sortbench_results.csv", "w");
+    FILE *wide[3];
+    for (int i = 0; i < 3; i++) wide[i] = fopen(wide_files[i], "w");
+    if (fp == NULL || wide[0] == NULL || wide[1] == NULL || wide[2] == NULL) {
+        printf("Error opening file!\n");
+        return 1;
+    }
+    fprintf(fp, "Distribution,ArraySize,Algorithm,Trials,Threads,"
+                "CompMin,CompMedian,CompMax,SwapsMin,SwapsMedian,SwapsMax,"
+                "SecondsMin,SecondsMedian,SecondsMax,CyclesMin,CyclesMedian,CyclesMax,"
+                "CacheMissesMedian,BranchMissesMedian\n");
+    for (int i = 0; i < 3; i++) wide_header(wide[i]);
+
+    zipf_init();
+    bench_worker *workers = calloc(threads, sizeof(bench_worker));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+
+    printf("seed = 0x%llx, up to %u threads, SIMD sort: %s\n", (unsigned long long)seed,
+           threads, simdsort_impl_name(simdsort_impl()));
+    static const int steps[] = {1, 2, 5};
+    for (long decade = 1000; decade <= max_n; decade *= 10) {
+        for (int s = 0; s < 3 && decade * steps[s] <= max_n; s++) {
+            long n = decade * steps[s];
+            int trials = trials_for(n);
+            unsigned nw = threads < (unsigned)trials ? threads : (unsigned)trials;
+            double fit = budget / (3.0 * (double)n * sizeof(int));
+            if (fit < nw) nw = fit >= 1 ? (unsigned)fit : 1;
+            for (unsigned t = 0; t < nw; t++) {
+                if (worker_reserve(&workers[t], n) != 0) {
+                    fprintf(stderr, "out of memory at n = %ld\n", n);
+                    return 1;
+                }
+            }
+
+            for (int d = 0; d < NDISTS; d++) {
+                size_job job = {(int)n, d, trials, seed ^ ((uint64_t)n << 8 ^ (uint64_t)d),
+                                calloc((size_t)trials * NALGS, sizeof(run_result)), 0, 0};
+                if (job.results == NULL) {
+                    fprintf(stderr, "out of memory at n = %ld\n", n);
+                    return 1;
+                }
+                for (unsigned t = 0; t < nw; t++) {
+                    workers[t].job = &job;
+                    pthread_create(&tids[t], NULL, bench_worker_main, &workers[t]);
+                }
+                for (unsigned t = 0; t < nw; t++) pthread_join(tids[t], NULL);
+                if (job.failed) return 1;
+
+                alg_stats st[NALGS];
+                printf("%-13s n = %-9ld", dist_names[d], n);
+                for (int a = 0; a < NALGS; a++) {
+                    if (!alg_runs(a, n)) continue;
+                    summarize(&job, a, &st[a]);
+                    printf(" %s %.4gs", algs[a].name, st[a].seconds[1]);
+                    fprintf(fp, "%s,%ld,%s,%d,%u,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.6f,%.6f,%.6f,%.0f,%.0f,%.0f",
+                            dist_names[d], n, algs[a].name, trials, nw,
+                            st[a].comparisons[0], st[a].comparisons[1], st[a].comparisons[2],
+                            st[a].swaps[0], st[a].swaps[1], st[a].swaps[2],
+                            st[a].seconds[0], st[a].seconds[1], st[a].seconds[2],
+                            st[a].cycles[0], st[a].cycles[1], st[a].cycles[2]);
+                    print_counter(fp, st[a].cache_misses[1]);
+                    print_counter(fp, st[a].branch_misses[1]);
+                    fprintf(fp, "\n");
+                }
+                printf("\n");
+                if (d == DIST_UNIFORM)
+                    for (int i = 0; i < 3; i++) wide_row(wide[i], n, st, i);
+                fflush(fp);
+                free(job.results);
+            }
+        }
+    }
+
+    if (!workers[0].perf_ok)
+        printf("perf_event_open unavailable: cache/branch miss columns left empty\n");
+    for (unsigned t = 0; t < threads; t++) {
+        free(workers[t].input);
+        free(workers[t].work);
+        free(workers[t].scratch);
+    }
+    free(workers);
+    free(tids);
+    fclose(fp);
+    for (int i = 0; i < 3; i++) fclose(wide[i]);
+    printf("Data written to sortbench_results.csv and sorting_{min,median,max}_data.csv\n");
+    return 0;
+}
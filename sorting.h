@@ -0,0 +1,123 @@
+// sorting.h
+// Shared sorting kernels for the sorting benchmarks (maxcomparison.c,
+// medianquick.c, merge.c, parsort.c, sortbench.c). Header-only: each benchmark
+// is a single translation unit, so the counters below are that program's
+// global counters. They are thread-local, so several threads can run the
+// counted kernels without racing on them.
+//
+// Counting convention: every key-to-key comparison increments 'comparisons';
+// every exchange of two elements increments 'swaps'. Sorts that move elements
+// instead of exchanging them count one swap per element moved out of order.
+//
+// The sorts are written once in sorting_impl.h and instantiated here under
+// three counting policies, picked at compile time by function name:
+//   introSort, bottomUpMergeSort, ...  LocalCount: the thread-local counters
+//                                      above (what the benchmarks report)
+//   introSortNoCount, ...              NoCount: no counting code at all, for
+//                                      timing and for use outside benchmarks
+//   introSortAtomicCount, ...          AtomicCount: shared_comparisons and
+//                                      shared_swaps, totals over all threads
+// Each family has insertionSort, introHeapSort, introSort, bubbleSort,
+// heapSort, heapSort4, heapSort8, mergeRuns, bottomUpMergeSort and powerSort.
+
+#ifndef SORTING_H
+#define SORTING_H
+
+#include <stdlib.h>
+#include <string.h>
+
+// Global counters for comparisons and swaps (one pair per thread)
+static _Thread_local unsigned long long comparisons = 0;
+static _Thread_local unsigned long long swaps = 0;
+
+// Process-wide counters of the AtomicCount family (relaxed atomic adds)
+static unsigned long long shared_comparisons = 0;
+static unsigned long long shared_swaps = 0;
+
+// Swap function
+static inline void swap(int* a, int* b) {
+    int temp = *a;
+    *a = *b;
+    *b = temp;
+    swaps++;
+}
+
+// --- Introsort ---------------------------------------------------------------
+// Quicksort with a ninther (median of three medians of three) pivot on large
+// ranges and median-of-3 on the rest, Hoare partitioning (equal keys stop both
+// scans, so runs of duplicates split evenly instead of degrading to O(n^2)),
+// insertion sort below INTRO_CUTOFF, and a heap sort fallback once the depth
+// exceeds 2*log2(n). Recursing into the smaller side and looping on the larger
+// one bounds the stack at O(log n) frames.
+
+#define INTRO_CUTOFF 16
+#define INTRO_NINTHER 128
+
+// --- Bottom-up merge sort ----------------------------------------------------
+// Sorts runs of MERGE_RUN elements with insertion sort, then merges runs of
+// doubling width, alternating between arr and one auxiliary buffer of n ints
+// (caller-provided, or allocated once per call when buf is NULL). Adjacent
+// runs that are already in order (last of left <= first of right) are copied
+// instead of merged, so presorted input costs one comparison per run pair.
+// Taking an element from the right run counts as a swap, like the top-down
+// merge it replaces.
+
+#define MERGE_RUN 8
+
+// --- Powersort ---------------------------------------------------------------
+// Natural merge sort for partially ordered input. Maximal ascending runs are
+// found as they are (strictly descending runs are reversed in place), runs
+// shorter than POWER_MINRUN are extended by binary insertion sort, and the
+// merge order comes from the powersort policy (Munro & Wild): the boundary
+// between two adjacent runs gets a "power", the depth of the node separating
+// their midpoints in a perfectly balanced binary tree over [0, n), and runs
+// on the stack are merged while the top boundary is deeper than the new one.
+// That keeps merges nearly balanced, costing about n*H + O(n) comparisons
+// where H is the entropy of the run lengths: linear on presorted input.
+// Merges trim the prefix of the left run and the suffix of the right run that
+// are already in place, copy only the left run to the buffer, and switch to
+// galloping (exponential search, then block moves) after POWER_MIN_GALLOP
+// consecutive wins by one side, as in TimSort.
+
+#define POWER_MINRUN 32
+#define POWER_MIN_GALLOP 7
+
+// Power of the boundary between runs [s1, s1+n1) and [s1+n1, s1+n1+n2) of an
+// array of n: the first bit where the scaled midpoints 2*mid/(2n) differ.
+static inline int powerSortNodePower(long s1, long n1, long n2, long n) {
+    long a = 2 * s1 + n1;
+    long b = a + n1 + n2;
+    int power = 0;
+    for (;;) {
+        power++;
+        if (a >= n) {
+            a -= n;
+            b -= n;
+        } else if (b >= n) {
+            break;
+        }
+        a <<= 1;
+        b <<= 1;
+    }
+    return power;
+}
+
+// --- Counting policies -------------------------------------------------------
+
+#define SORT_NOCOUNT 0
+#define SORT_LOCALCOUNT 1
+#define SORT_ATOMICCOUNT 2
+
+#define SORT_SUFFIX
+#define SORT_POLICY SORT_LOCALCOUNT
+#include "sorting_impl.h"
+
+#define SORT_SUFFIX NoCount
+#define SORT_POLICY SORT_NOCOUNT
+#include "sorting_impl.h"
+
+#define SORT_SUFFIX AtomicCount
+#define SORT_POLICY SORT_ATOMICCOUNT
+#include "sorting_impl.h"
+
+#endif // SORTING_H
@@ -0,0 +1,456 @@
+// sorting_impl.h
+// Body of the comparison sorts in sorting.h, written once and instantiated
+// per counting policy. There is deliberately no include guard: every
+// inclusion defines one more family of functions. Set before including:
+//   SORT_SUFFIX  appended to every function name (may be empty)
+//   SORT_POLICY  SORT_NOCOUNT, SORT_LOCALCOUNT or SORT_ATOMICCOUNT
+//   SORT_LESS    optional strict-weak-order comparator on two ints,
+//                default ((a) < (b))
+// All four are #undef'd at the end. Under SORT_NOCOUNT the counting macros
+// expand to nothing, so that family is the plain sort with no side effects in
+// its loops. Example, a descending uncounted introsort named introSortDesc:
+//   #define SORT_SUFFIX Desc
+//   #define SORT_POLICY SORT_NOCOUNT
+//   #define SORT_LESS(a, b) ((a) > (b))
+//   #include "sorting_impl.h"
+
+#ifndef SORTING_H
+#error "include sorting.h, which instantiates this file"
+#endif
+
+#define SORT_CAT_(a, b) a##b
+#define SORT_CAT(a, b) SORT_CAT_(a, b)
+#define SORT_FN(name) SORT_CAT(name, SORT_SUFFIX)
+
+#ifndef SORT_LESS
+#define SORT_LESS(a, b) ((a) < (b))
+#endif
+
+#if SORT_POLICY == SORT_LOCALCOUNT
+#define SORT_CMP() (comparisons++)
+#define SORT_MOVE(k) (swaps += (k))
+#elif SORT_POLICY == SORT_ATOMICCOUNT
+#define SORT_CMP() __atomic_fetch_add(&shared_comparisons, 1, __ATOMIC_RELAXED)
+#define SORT_MOVE(k) __atomic_fetch_add(&shared_swaps, (k), __ATOMIC_RELAXED)
+#else
+#define SORT_CMP() ((void)0)
+#define SORT_MOVE(k) ((void)0)
+#endif
+
+static inline void SORT_FN(sortSwap)(int *a, int *b) {
+    int temp = *a;
+    *a = *b;
+    *b = temp;
+    SORT_MOVE(1);
+}
+
+// --- Insertion sort ----------------------------------------------------------
+
+// Sorts arr[low..high] in place. Each element shifted right counts as a swap.
+static inline void SORT_FN(insertionSort)(int arr[], int low, int high) {
+    for (int i = low + 1; i <= high; i++) {
+        int key = arr[i];
+        int j = i - 1;
+        while (j >= low) {
+            SORT_CMP();
+            if (!SORT_LESS(key, arr[j])) break;
+            arr[j + 1] = arr[j];
+            SORT_MOVE(1);
+            j--;
+        }
+        arr[j + 1] = key;
+    }
+}
+
+// --- Introsort ---------------------------------------------------------------
+
+// Heap sort of arr[low..high], used when introsort exceeds its depth limit.
+static inline void SORT_FN(introSiftDown)(int arr[], int low, int n, int i) {
+    for (;;) {
+        int largest = i;
+        int left = 2 * i + 1;
+        int right = 2 * i + 2;
+        if (left < n) {
+            SORT_CMP();
+            if (SORT_LESS(arr[low + largest], arr[low + left])) largest = left;
+        }
+        if (right < n) {
+            SORT_CMP();
+            if (SORT_LESS(arr[low + largest], arr[low + right])) largest = right;
+        }
+        if (largest == i) return;
+        SORT_FN(sortSwap)(&arr[low + i], &arr[low + largest]);
+        i = largest;
+    }
+}
+
+static inline void SORT_FN(introHeapSort)(int arr[], int low, int high) {
+    int n = high - low + 1;
+    for (int i = n / 2 - 1; i >= 0; i--) SORT_FN(introSiftDown)(arr, low, n, i);
+    for (int i = n - 1; i > 0; i--) {
+        SORT_FN(sortSwap)(&arr[low], &arr[low + i]);
+        SORT_FN(introSiftDown)(arr, low, i, 0);
+    }
+}
+
+// Index of the median of arr[a], arr[b], arr[c]
+static inline int SORT_FN(medianOf3)(int arr[], int a, int b, int c) {
+    SORT_CMP();
+    if (SORT_LESS(arr[a], arr[b])) {
+        SORT_CMP();
+        if (SORT_LESS(arr[b], arr[c])) return b;
+        SORT_CMP();
+        return SORT_LESS(arr[a], arr[c]) ? c : a;
+    }
+    SORT_CMP();
+    if (SORT_LESS(arr[a], arr[c])) return a;
+    SORT_CMP();
+    return SORT_LESS(arr[b], arr[c]) ? c : b;
+}
+
+static inline int SORT_FN(choosePivot)(int arr[], int low, int high) {
+    int n = high - low + 1;
+    int mid = low + n / 2;
+    if (n > INTRO_NINTHER) {
+        int s = n / 8;
+        int a = SORT_FN(medianOf3)(arr, low, low + s, low + 2 * s);
+        int b = SORT_FN(medianOf3)(arr, mid - s, mid, mid + s);
+        int c = SORT_FN(medianOf3)(arr, high - 2 * s, high - s, high);
+        return SORT_FN(medianOf3)(arr, a, b, c);
+    }
+    return SORT_FN(medianOf3)(arr, low, mid, high);
+}
+
+// Hoare partition around the pivot value; returns j such that every element
+// of arr[low..j] is <= pivot and every element of arr[j+1..high] is >= pivot,
+// with low <= j < high.
+static inline int SORT_FN(hoarePartition)(int arr[], int low, int high) {
+    int p = SORT_FN(choosePivot)(arr, low, high);
+    if (p != low) SORT_FN(sortSwap)(&arr[low], &arr[p]);
+    int pivot = arr[low];
+    int i = low - 1;
+    int j = high + 1;
+    for (;;) {
+        do { i++; SORT_CMP(); } while (SORT_LESS(arr[i], pivot));
+        do { j--; SORT_CMP(); } while (SORT_LESS(pivot, arr[j]));
+        if (i >= j) return j;
+        SORT_FN(sortSwap)(&arr[i], &arr[j]);
+    }
+}
+
+static inline void SORT_FN(introSortLoop)(int arr[], int low, int high, int depth) {
+    while (high - low + 1 > INTRO_CUTOFF) {
+        if (depth-- == 0) {
+            SORT_FN(introHeapSort)(arr, low, high);
+            return;
+        }
+        int p = SORT_FN(hoarePartition)(arr, low, high);
+        if (p - low < high - p) {
+            SORT_FN(introSortLoop)(arr, low, p, depth);
+            low = p + 1;
+        } else {
+            SORT_FN(introSortLoop)(arr, p + 1, high, depth);
+            high = p;
+        }
+    }
+    SORT_FN(insertionSort)(arr, low, high);
+}
+
+// Sorts arr[low..high] in place.
+static inline void SORT_FN(introSort)(int arr[], int low, int high) {
+    int depth = 0;
+    for (int n = high - low + 1; n > 1; n >>= 1) depth += 2;
+    if (low < high) SORT_FN(introSortLoop)(arr, low, high, depth);
+}
+
+// --- Baseline sorts ----------------------------------------------------------
+
+// Bubble sort of arr[0..n-1] (no early exit, so always n(n-1)/2 comparisons)
+static inline void SORT_FN(bubbleSort)(int arr[], int n) {
+    for (int i = 0; i < n - 1; i++) {
+        for (int j = 0; j < n - i - 1; j++) {
+            SORT_CMP();
+            if (SORT_LESS(arr[j + 1], arr[j])) {
+                SORT_FN(sortSwap)(&arr[j], &arr[j + 1]);
+            }
+        }
+    }
+}
+
+// Binary heap sort of arr[0..n-1] (the introsort fallback on the whole array)
+static inline void SORT_FN(heapSort)(int arr[], int n) {
+    if (n > 1) SORT_FN(introHeapSort)(arr, 0, n - 1);
+}
+
+// --- d-ary heap sort ---------------------------------------------------------
+// Max-heap with the children of i at d*i+1 .. d*i+d and Floyd's bottom-up
+// sift (see dheap.h for why). Each key moved into a hole counts as one swap.
+
+// Places x in the hole at i of the d-ary heap arr[0..n-1]: the hole goes down
+// along the largest children, then x walks back up from the leaf.
+static inline void SORT_FN(daryFloydSift)(int arr[], int n, int i, int x, int d) {
+    int hole = i;
+    for (;;) {
+        long first = (long)d * hole + 1;
+        if (first >= n) break;
+        int best = (int)first;
+        int end = first + d < n ? (int)first + d : n;
+        for (int c = best + 1; c < end; c++) {
+            SORT_CMP();
+            if (SORT_LESS(arr[best], arr[c])) best = c;
+        }
+        arr[hole] = arr[best];
+        SORT_MOVE(1);
+        hole = best;
+    }
+    while (hole > i) {
+        int parent = (hole - 1) / d;
+        SORT_CMP();
+        if (!SORT_LESS(arr[parent], x)) break;
+        arr[hole] = arr[parent];
+        SORT_MOVE(1);
+        hole = parent;
+    }
+    arr[hole] = x;
+}
+
+// d is a constant at every call below, so the sift is specialized per arity
+static inline void SORT_FN(daryHeapSort)(int arr[], int n, int d) {
+    if (n < 2) return;
+    for (int i = (n - 2) / d; i >= 0; i--) SORT_FN(daryFloydSift)(arr, n, i, arr[i], d);
+    for (int end = n - 1; end > 0; end--) {
+        int x = arr[end];
+        arr[end] = arr[0];
+        SORT_MOVE(1);
+        SORT_FN(daryFloydSift)(arr, end, 0, x, d);
+    }
+}
+
+// 4- and 8-ary heap sorts of arr[0..n-1]
+static inline void SORT_FN(heapSort4)(int arr[], int n) {
+    SORT_FN(daryHeapSort)(arr, n, 4);
+}
+
+static inline void SORT_FN(heapSort8)(int arr[], int n) {
+    SORT_FN(daryHeapSort)(arr, n, 8);
+}
+
+// --- Bottom-up merge sort ----------------------------------------------------
+
+static inline void SORT_FN(mergeRuns)(const int src[], int dst[], int low, int mid, int high) {
+    int i = low, j = mid, k = low;
+    if (mid < high) {
+        SORT_CMP();
+        if (!SORT_LESS(src[mid], src[mid - 1])) {
+            memcpy(dst + low, src + low, (size_t)(high - low) * sizeof(int));
+            return;
+        }
+    }
+    while (i < mid && j < high) {
+        SORT_CMP();
+        if (!SORT_LESS(src[j], src[i])) {
+            dst[k++] = src[i++];
+        } else {
+            dst[k++] = src[j++];
+            SORT_MOVE(1);
+        }
+    }
+    while (i < mid) dst[k++] = src[i++];
+    while (j < high) dst[k++] = src[j++];
+}
+
+// Sorts arr[0..n-1]. Returns 0, or -1 if the buffer could not be allocated.
+static inline int SORT_FN(bottomUpMergeSort)(int arr[], int n, int buf[]) {
+    int *own = NULL;
+    if (n < 2) return 0;
+    if (buf == NULL) {
+        own = malloc((size_t)n * sizeof(int));
+        if (own == NULL) return -1;
+        buf = own;
+    }
+
+    for (int low = 0; low < n; low += MERGE_RUN) {
+        int high = low + MERGE_RUN < n ? low + MERGE_RUN : n;
+        SORT_FN(insertionSort)(arr, low, high - 1);
+    }
+
+    int *src = arr, *dst = buf;
+    for (int width = MERGE_RUN; width < n; width *= 2) {
+        for (int low = 0; low < n; low += 2 * width) {
+            int mid = low + width < n ? low + width : n;
+            int high = low + 2 * width < n ? low + 2 * width : n;
+            SORT_FN(mergeRuns)(src, dst, low, mid, high);
+        }
+        int *t = src; src = dst; dst = t;
+    }
+    if (src != arr) memcpy(arr, src, (size_t)n * sizeof(int));
+
+    free(own);
+    return 0;
+}
+
+// --- Powersort ---------------------------------------------------------------
+
+// Number of leading elements of a[0..n) that are < key (key < a[i] if right,
+// i.e. <= key): exponential search from the front, then binary search.
+static inline int SORT_FN(gallop)(int key, const int a[], int n, int right) {
+    int lo = 0, hi = 1;
+    while (hi <= n) {
+        SORT_CMP();
+        if (right ? SORT_LESS(key, a[hi - 1]) : !SORT_LESS(a[hi - 1], key)) {
+            hi--;
+            break;
+        }
+        lo = hi;
+        hi = 2 * hi + 1;
+    }
+    if (hi > n) hi = n;
+    // a[lo-1] is on the left side and a[hi] on the right: answer in [lo, hi]
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        SORT_CMP();
+        if (right ? SORT_LESS(key, a[mid]) : !SORT_LESS(a[mid], key)) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+// arr[low..start) is sorted; inserts arr[start..high) by binary search.
+static inline void SORT_FN(binaryInsertionSort)(int arr[], int low, int start, int high) {
+    for (int i = start; i < high; i++) {
+        int key = arr[i];
+        int pos = low + SORT_FN(gallop)(key, arr + low, i - low, 1);
+        memmove(arr + pos + 1, arr + pos, (size_t)(i - pos) * sizeof(int));
+        SORT_MOVE(i - pos);
+        arr[pos] = key;
+    }
+}
+
+// End of the run starting at low, made ascending and at least POWER_MINRUN long
+// (or up to n).
+static inline int SORT_FN(powerRunEnd)(int arr[], int low, int n) {
+    int end = low + 1;
+    if (end < n) {
+        SORT_CMP();
+        if (SORT_LESS(arr[end], arr[low])) {
+            // Strictly descending, so reversing keeps equal keys in order
+            end++;
+            while (end < n) {
+                SORT_CMP();
+                if (!SORT_LESS(arr[end], arr[end - 1])) break;
+                end++;
+            }
+            for (int i = low, j = end - 1; i < j; i++, j--) SORT_FN(sortSwap)(&arr[i], &arr[j]);
+        } else {
+            end++;
+            while (end < n) {
+                SORT_CMP();
+                if (SORT_LESS(arr[end], arr[end - 1])) break;
+                end++;
+            }
+        }
+    }
+    int want = low + POWER_MINRUN < n ? low + POWER_MINRUN : n;
+    if (end < want) {
+        SORT_FN(binaryInsertionSort)(arr, low, end, want);
+        end = want;
+    }
+    return end;
+}
+
+// Merges the sorted runs arr[low..mid) and arr[mid..high) using buf.
+static inline void SORT_FN(powerMerge)(int arr[], int low, int mid, int high, int buf[]) {
+    // Left keys <= arr[mid] and right keys >= arr[mid-1] are already in place
+    low += SORT_FN(gallop)(arr[mid], arr + low, mid - low, 1);
+    if (low == mid) return;
+    high = mid + SORT_FN(gallop)(arr[mid - 1], arr + mid, high - mid, 0);
+
+    int na = mid - low;
+    memcpy(buf, arr + low, (size_t)na * sizeof(int));
+    int i = 0, j = mid, k = low;
+    int min_gallop = POWER_MIN_GALLOP;
+    while (i < na && j < high) {
+        // One at a time until one side wins min_gallop times in a row
+        int wins_a = 0, wins_b = 0;
+        while (i < na && j < high && wins_a < min_gallop && wins_b < min_gallop) {
+            SORT_CMP();
+            if (SORT_LESS(arr[j], buf[i])) {
+                arr[k++] = arr[j++];
+                SORT_MOVE(1);
+                wins_b++;
+                wins_a = 0;
+            } else {
+                arr[k++] = buf[i++];
+                wins_a++;
+                wins_b = 0;
+            }
+        }
+        // Galloping: move whole blocks while they stay long
+        while (i < na && j < high) {
+            int ca = SORT_FN(gallop)(arr[j], buf + i, na - i, 1);
+            memcpy(arr + k, buf + i, (size_t)ca * sizeof(int));
+            k += ca;
+            i += ca;
+            if (i == na) break;
+            int cb = SORT_FN(gallop)(buf[i], arr + j, high - j, 0);
+            memmove(arr + k, arr + j, (size_t)cb * sizeof(int));
+            SORT_MOVE(cb);
+            k += cb;
+            j += cb;
+            arr[k++] = buf[i++];
+            if (min_gallop > 1) min_gallop--;
+            if (ca < POWER_MIN_GALLOP && cb < POWER_MIN_GALLOP) {
+                min_gallop += 2; // galloping stopped paying; make re-entry harder
+                break;
+            }
+        }
+    }
+    // The rest of the right run is already in place
+    memcpy(arr + k, buf + i, (size_t)(na - i) * sizeof(int));
+}
+
+// Sorts arr[0..n-1] (stable). buf as for bottomUpMergeSort. Returns 0, or -1
+// if the buffer could not be allocated.
+static inline int SORT_FN(powerSort)(int arr[], int n, int buf[]) {
+    int *own = NULL;
+    if (n < 2) return 0;
+    if (buf == NULL) {
+        own = malloc((size_t)n * sizeof(int));
+        if (own == NULL) return -1;
+        buf = own;
+    }
+
+    // Powers on the stack strictly increase, and are at most 64
+    struct { int start, power; } stack[66];
+    int top = 0;
+    int a_start = 0, a_end = SORT_FN(powerRunEnd)(arr, 0, n);
+    while (a_end < n) {
+        int b_end = SORT_FN(powerRunEnd)(arr, a_end, n);
+        int p = powerSortNodePower(a_start, a_end - a_start, b_end - a_end, n);
+        while (top > 0 && stack[top - 1].power > p) {
+            SORT_FN(powerMerge)(arr, stack[top - 1].start, a_start, a_end, buf);
+            a_start = stack[--top].start;
+        }
+        stack[top].start = a_start;
+        stack[top].power = p;
+        top++;
+        a_start = a_end;
+        a_end = b_end;
+    }
+    while (top > 0) {
+        SORT_FN(powerMerge)(arr, stack[top - 1].start, a_start, n, buf);
+        a_start = stack[--top].start;
+    }
+
+    free(own);
+    return 0;
+}
+
+#undef SORT_CMP
+#undef SORT_MOVE
+#undef SORT_FN
+#undef SORT_CAT
+#undef SORT_CAT_
+#undef SORT_LESS
+#undef SORT_POLICY
+#undef SORT_SUFFIX
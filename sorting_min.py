@@ -15,6 +15,9 @@ bs_swaps = data['BubbleSortSwaps']
 hs_comp = data['HeapSortComp']
 hs_swaps = data['HeapSortSwaps']
 
+# sortbench.c sweeps sizes over several decades: use log axes there
+log_axes = sizes.max() > 100 * sizes.min()
+
 # -------- Plot Minimum Comparisons --------
 plt.figure(figsize=(10, 6))
 plt.plot(sizes, qs_comp, label='QuickSort', marker='o', color='#1f77b4')
@@ -22,6 +25,9 @@ plt.plot(sizes, ms_comp, label='MergeSort', marker='s', color='#ff7f0e')
 plt.plot(sizes, bs_comp, label='BubbleSort', marker='^', color='#2ca02c')
 plt.plot(sizes, hs_comp, label='HeapSort', marker='d', color='#d62728')
 
+if log_axes:
+    plt.xscale('log')
+    plt.yscale('log')
 plt.xlabel('Array Size')
 plt.ylabel('Minimum Comparisons')
 plt.title('Minimum Comparisons vs Array Size')
@@ -41,6 +47,9 @@ plt.plot(sizes, ms_swaps, label='MergeSort', marker='s', color='#ff7f0e')
 plt.plot(sizes, bs_swaps, label='BubbleSort', marker='^', color='#2ca02c')
 plt.plot(sizes, hs_swaps, label='HeapSort', marker='d', color='#d62728')
 
+if log_axes:
+    plt.xscale('log')
+    plt.yscale('log')
 plt.xlabel('Array Size')
 plt.ylabel('Minimum Swaps')
 plt.title('Minimum Swaps vs Array Size')
@@ -52,3 +61,23 @@ plt.savefig(swaps_img, dpi=300)
 plt.show()
 print(f"Saved swaps plot as: {swaps_img}")
 
+# -------- Plot Minimum Time (sortbench.c output only) --------
+if 'QuickSortSeconds' in data:
+    plt.figure(figsize=(10, 6))
+    for name, marker in [('QuickSort', 'o'), ('MergeSort', 's'), ('BubbleSort', '^'),
+                         ('HeapSort', 'd'), ('RadixSort', 'x'), ('SimdSort', 'v')]:
+        plt.plot(sizes, data[name + 'Seconds'], label=name, marker=marker)
+
+    if log_axes:
+        plt.xscale('log')
+        plt.yscale('log')
+    plt.xlabel('Array Size')
+    plt.ylabel('Minimum Seconds')
+    plt.title('Minimum Time vs Array Size')
+    plt.legend()
+    plt.grid(True)
+
+    time_img = "sorting_min_time.png"
+    plt.savefig(time_img, dpi=300)
+    plt.show()
+    print(f"Saved time plot as: {time_img}")
@@ -0,0 +1,183 @@
+// stats.h
+// Streaming summary statistics for benchmark samples (cycle counts, operation
+// counts, nanoseconds): count, min, max, mean and quantiles of a stream of
+// non-negative integers, in bounded memory.
+//   - Up to QSTAT_EXACT samples are kept as they are, and quantiles of those
+//     are exact (quickselect).
+//   - Every sample also goes into a log-bucket histogram in the style of
+//     HdrHistogram: 2^QSTAT_SUB_BITS linear sub-buckets per power of two, so
+//     any value is placed with relative error below 2^-QSTAT_SUB_BITS (0.8%).
+//     Past QSTAT_EXACT samples the kept samples are dropped and quantiles come
+//     from the histogram. Values below 2^QSTAT_SUB_BITS are exact there too.
+// Two summaries merge by adding histograms, so each thread can keep its own
+// and the totals are combined after the join. The histogram (about 60 KB) is
+// only allocated once a summary outgrows the exact sample buffer.
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QSTAT_EXACT 1024
+#define QSTAT_SUB_BITS 7
+#define QSTAT_SUB (1 << QSTAT_SUB_BITS)
+#define QSTAT_BUCKETS ((64 - QSTAT_SUB_BITS + 1) * QSTAT_SUB)
+
+typedef struct {
+    uint64_t count;
+    uint64_t min, max;
+    long double sum;
+    uint64_t *samples;  // the first samples while count <= QSTAT_EXACT
+    uint64_t *hist;     // QSTAT_BUCKETS counts, once count > QSTAT_EXACT
+} qstat;
+
+static inline void qstat_init(qstat *s) {
+    memset(s, 0, sizeof(*s));
+    s->min = UINT64_MAX;
+}
+
+static inline void qstat_clear(qstat *s) {
+    free(s->samples);
+    free(s->hist);
+    qstat_init(s);
+}
+
+// --- Histogram buckets -------------------------------------------------------
+
+static inline int qstatBucket(uint64_t v) {
+    if (v < QSTAT_SUB) return (int)v;
+    int e = 63 - __builtin_clzll(v); // e >= QSTAT_SUB_BITS
+    int shift = e - QSTAT_SUB_BITS;
+    return ((shift + 1) << QSTAT_SUB_BITS) + (int)((v >> shift) & (QSTAT_SUB - 1));
+}
+
+// Smallest value of bucket b and the bucket's width
+static inline uint64_t qstatBucketLow(int b, uint64_t *width) {
+    if (b < QSTAT_SUB) {
+        *width = 1;
+        return (uint64_t)b;
+    }
+    int shift = (b >> QSTAT_SUB_BITS) - 1;
+    *width = (uint64_t)1 << shift;
+    return ((uint64_t)(QSTAT_SUB + (b & (QSTAT_SUB - 1)))) << shift;
+}
+
+// Moves the kept samples into a new histogram. Returns -1 if out of memory.
+static inline int qstatSpill(qstat *s) {
+    s->hist = calloc(QSTAT_BUCKETS, sizeof(uint64_t));
+    if (s->hist == NULL) return -1;
+    uint64_t kept = s->count < QSTAT_EXACT ? s->count : QSTAT_EXACT;
+    for (uint64_t i = 0; i < kept; i++) s->hist[qstatBucket(s->samples[i])]++;
+    free(s->samples);
+    s->samples = NULL;
+    return 0;
+}
+
+// --- Recording and merging ---------------------------------------------------
+
+// Returns 0, or -1 if memory for the sample buffer or histogram ran out.
+static inline int qstat_add(qstat *s, uint64_t v) {
+    if (s->hist == NULL) {
+        if (s->count == QSTAT_EXACT) {
+            if (qstatSpill(s) != 0) return -1;
+        } else {
+            if (s->samples == NULL) {
+                s->samples = malloc(QSTAT_EXACT * sizeof(uint64_t));
+                if (s->samples == NULL) return -1;
+            }
+            s->samples[s->count] = v;
+        }
+    }
+    if (s->hist) s->hist[qstatBucket(v)]++;
+    s->count++;
+    s->sum += v;
+    if (v < s->min) s->min = v;
+    if (v > s->max) s->max = v;
+    return 0;
+}
+
+// Adds the samples summarized by src to dst. Returns 0, or -1 if out of memory.
+static inline int qstat_merge(qstat *dst, const qstat *src) {
+    if (src->count == 0) return 0;
+    if (src->hist == NULL && dst->hist == NULL && dst->count + src->count <= QSTAT_EXACT) {
+        for (uint64_t i = 0; i < src->count; i++)
+            if (qstat_add(dst, src->samples[i]) != 0) return -1;
+        return 0;
+    }
+    if (dst->hist == NULL && qstatSpill(dst) != 0) return -1;
+    if (src->hist) {
+        for (int b = 0; b < QSTAT_BUCKETS; b++) dst->hist[b] += src->hist[b];
+    } else {
+        for (uint64_t i = 0; i < src->count; i++) dst->hist[qstatBucket(src->samples[i])]++;
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+    return 0;
+}
+
+// --- Queries -----------------------------------------------------------------
+
+// k-th smallest (0-based) of a[0..n-1]; reorders a.
+static inline uint64_t qstatSelect(uint64_t *a, uint64_t n, uint64_t k) {
+    int64_t lo = 0, hi = (int64_t)n - 1, kk = (int64_t)k;
+    while (lo < hi) {
+        uint64_t pivot = a[lo + (hi - lo) / 2];
+        int64_t i = lo, j = hi;
+        while (i <= j) {
+            while (a[i] < pivot) i++;
+            while (a[j] > pivot) j--;
+            if (i <= j) {
+                uint64_t t = a[i]; a[i] = a[j]; a[j] = t;
+                i++;
+                j--;
+            }
+        }
+        // a[lo..j] <= pivot <= a[i..hi], and a[j+1..i-1] == pivot
+        if (kk <= j) hi = j;
+        else if (kk >= i) lo = i;
+        else return a[k];
+    }
+    return a[k];
+}
+
+static inline double qstat_mean(const qstat *s) {
+    return s->count ? (double)(s->sum / s->count) : 0.0;
+}
+
+// Value of nearest rank ceil(p * count), p in [0, 1]; 0 for an empty summary.
+// Exact while the samples are kept, else the middle of the histogram bucket
+// (clamped to [min, max]).
+static inline uint64_t qstat_quantile(qstat *s, double p) {
+    if (s->count == 0) return 0;
+    uint64_t rank = (uint64_t)(p * (double)s->count + 0.999999999);
+    if (rank < 1) rank = 1;
+    if (rank > s->count) rank = s->count;
+    if (s->hist == NULL) return qstatSelect(s->samples, s->count, rank - 1);
+
+    uint64_t seen = 0;
+    for (int b = 0; b < QSTAT_BUCKETS; b++) {
+        seen += s->hist[b];
+        if (seen >= rank) {
+            uint64_t width, v = qstatBucketLow(b, &width);
+            v += width / 2;
+            return v < s->min ? s->min : v > s->max ? s->max : v;
+        }
+    }
+    return s->max;
+}
+
+// Median, averaging the two middle samples of an even count while exact
+static inline uint64_t qstat_median(qstat *s) {
+    if (s->hist == NULL && s->count > 0 && s->count % 2 == 0) {
+        uint64_t lo = qstatSelect(s->samples, s->count, s->count / 2 - 1);
+        uint64_t hi = qstatSelect(s->samples, s->count, s->count / 2);
+        return lo + (hi - lo) / 2;
+    }
+    return qstat_quantile(s, 0.5);
+}
+
+#endif // STATS_H
@@ -0,0 +1,153 @@
+// uring.h
+// Minimal io_uring on the raw system calls (no liburing), for filecrypt.h.
+//   uring_init          - io_uring_setup and the ring mappings. Returns
+//                         -errno when the kernel has no io_uring or it is
+//                         blocked (ENOSYS, EPERM under seccomp), so callers
+//                         can fall back to pread/pwrite.
+//   uring_register_buffers - pins buffers for IORING_OP_READ_FIXED /
+//                         WRITE_FIXED, which skip the per-I/O page mapping
+//   uring_get_sqe, uring_prep - fill a submission queue entry
+//   uring_enter         - submits the queued entries and optionally waits for
+//                         completions
+//   uring_next_cqe      - takes one completion, if any
+// One thread owns a ring: head and tail updates use acquire/release only
+// against the kernel.
+
+#ifndef URING_H
+#define URING_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_bytes, cq_ring_bytes, sqes_bytes;
+    unsigned sqe_tail;  // entries filled, published to the kernel on uring_enter
+    unsigned queued;    // filled since the last uring_enter
+} uring;
+
+static inline int uring_init(uring *r, unsigned entries) {
+    struct io_uring_params p;
+    memset(r, 0, sizeof(*r));
+    memset(&p, 0, sizeof(p));
+    long fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0) return -errno;
+    r->fd = (int)fd;
+
+    r->sq_ring_bytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_bytes = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_ring_bytes > r->sq_ring_bytes) r->sq_ring_bytes = r->cq_ring_bytes;
+        r->cq_ring_bytes = r->sq_ring_bytes;
+    }
+    r->sq_ring = mmap(NULL, r->sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) goto fail;
+    }
+    r->sqes_bytes = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) goto fail;
+
+    char *sq = r->sq_ring, *cq = r->cq_ring;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->sqe_tail = *r->sq_tail;
+    return 0;
+
+fail: {
+        int err = errno;
+        if (r->sqes && r->sqes != MAP_FAILED) munmap(r->sqes, r->sqes_bytes);
+        if (r->cq_ring && r->cq_ring != MAP_FAILED && r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_bytes);
+        if (r->sq_ring && r->sq_ring != MAP_FAILED) munmap(r->sq_ring, r->sq_ring_bytes);
+        close(r->fd);
+        return -err;
+    }
+}
+
+static inline void uring_destroy(uring *r) {
+    munmap(r->sqes, r->sqes_bytes);
+    if (r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_bytes);
+    munmap(r->sq_ring, r->sq_ring_bytes);
+    close(r->fd);
+}
+
+// Returns 0, or -errno (e.g. ENOMEM when RLIMIT_MEMLOCK is too small on
+// older kernels).
+static inline int uring_register_buffers(uring *r, const struct iovec *iov, unsigned n) {
+    long ret = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS, iov, n);
+    return ret < 0 ? -errno : 0;
+}
+
+// Next free submission entry, or NULL when the submission queue is full
+static inline struct io_uring_sqe *uring_get_sqe(uring *r) {
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if (r->sqe_tail - head >= *r->sq_mask + 1) return NULL;
+    unsigned idx = r->sqe_tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    r->sq_array[idx] = idx;
+    r->sqe_tail++;
+    r->queued++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static inline void uring_prep(struct io_uring_sqe *sqe, int op, int fd, void *buf, unsigned len,
+                              uint64_t off, uint64_t user_data) {
+    sqe->opcode = (uint8_t)op;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = off;
+    sqe->user_data = user_data;
+}
+
+// Submits the queued entries and, if wait_nr > 0, blocks until that many
+// completions are available. Returns 0 or -errno.
+static inline int uring_enter(uring *r, unsigned wait_nr) {
+    __atomic_store_n(r->sq_tail, r->sqe_tail, __ATOMIC_RELEASE);
+    unsigned submit = r->queued;
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, r->fd, submit, wait_nr,
+                           wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret >= 0) {
+            r->queued = submit - (unsigned)ret;
+            return 0;
+        }
+        if (errno != EINTR) return -errno;
+    }
+}
+
+// Copies the oldest completion to *out and consumes it. Returns 0 if none.
+static inline int uring_next_cqe(uring *r, struct io_uring_cqe *out) {
+    unsigned head = *r->cq_head;
+    if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) return 0;
+    *out = r->cqes[head & *r->cq_mask];
+    __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+#endif // URING_H
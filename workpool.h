@@ -0,0 +1,221 @@
+// workpool.h
+// Fork-join thread pool with work stealing, for the parallel sorts.
+// Each worker owns a deque: it pushes and pops spawned tasks at the bottom,
+// idle workers steal from the top of a victim's deque (the oldest, hence
+// largest, pieces of a divide-and-conquer). wp_sync() helps by running
+// queued tasks while its group is pending, so nested spawns never block a
+// worker. The thread calling wp_run() acts as worker 0.
+//
+// Header-only; link with -pthread.
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#define WP_DEQUE_CAP 1024 // tasks per worker; spawns beyond this run inline
+
+typedef void (*wp_fn)(void *arg);
+
+// Completion counter for a set of spawned tasks; zero-initialize before use.
+typedef struct {
+    long pending;
+} wp_group;
+
+typedef struct {
+    wp_fn fn;
+    void *arg;
+    wp_group *group;
+} wp_task;
+
+typedef struct {
+    pthread_mutex_t lock;
+    unsigned top, bottom; // live tasks are tasks[top .. bottom) mod capacity
+    wp_task tasks[WP_DEQUE_CAP];
+} wp_deque;
+
+typedef struct wp_pool {
+    unsigned nworkers; // including the thread that calls wp_run
+    wp_deque *deques;
+    pthread_t *threads;
+    unsigned started;  // threads[1 .. started] are running
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    long queued;   // tasks sitting in deques
+    long sleepers; // workers blocked on idle_cond
+    int stop;
+} wp_pool;
+
+typedef struct {
+    wp_pool *pool;
+    unsigned self;
+} wp_worker_arg;
+
+static _Thread_local wp_pool *wp_current;
+static _Thread_local unsigned wp_self;
+static _Thread_local unsigned wp_victim_seed;
+
+static inline int wp_deque_push(wp_deque *d, const wp_task *t) {
+    int ok = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom - d->top < WP_DEQUE_CAP) {
+        d->tasks[d->bottom++ % WP_DEQUE_CAP] = *t;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static inline int wp_deque_pop(wp_deque *d, wp_task *t) {
+    int ok = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom != d->top) {
+        *t = d->tasks[--d->bottom % WP_DEQUE_CAP];
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+static inline int wp_deque_steal(wp_deque *d, wp_task *t) {
+    int ok = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom != d->top) {
+        *t = d->tasks[d->top++ % WP_DEQUE_CAP];
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+// Run one queued task (own deque first, then a steal). Returns 0 if none found.
+static inline int wp_run_one(wp_pool *pool, unsigned self) {
+    wp_task t;
+    int found = wp_deque_pop(&pool->deques[self], &t);
+    if (!found) {
+        unsigned start = (wp_victim_seed = wp_victim_seed * 1103515245u + 12345u) >> 16;
+        for (unsigned k = 0; k < pool->nworkers && !found; k++) {
+            unsigned v = (start + k) % pool->nworkers;
+            if (v != self) found = wp_deque_steal(&pool->deques[v], &t);
+        }
+    }
+    if (!found) return 0;
+    __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+    t.fn(t.arg);
+    __atomic_sub_fetch(&t.group->pending, 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static void *wp_worker_main(void *p) {
+    wp_worker_arg *w = p;
+    wp_pool *pool = w->pool;
+    wp_current = pool;
+    wp_self = w->self;
+    wp_victim_seed = w->self * 2654435761u;
+    free(w);
+
+    while (!__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) {
+        if (wp_run_one(pool, wp_self)) continue;
+        pthread_mutex_lock(&pool->idle_lock);
+        __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 &&
+               !__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE))
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+    return NULL;
+}
+
+// Queue fn(arg) as part of 'group' on the calling worker. Must be called from
+// inside wp_run (directly or from a task); arg must outlive the wp_sync.
+static inline void wp_spawn(wp_group *group, wp_fn fn, void *arg) {
+    wp_pool *pool = wp_current;
+    wp_task t = {fn, arg, group};
+    __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+    if (pool == NULL || pool->nworkers == 1 || !wp_deque_push(&pool->deques[wp_self], &t)) {
+        fn(arg);
+        __atomic_sub_fetch(&group->pending, 1, __ATOMIC_RELEASE);
+        return;
+    }
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->idle_lock);
+        pthread_cond_signal(&pool->idle_cond);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+}
+
+// Wait for every task of 'group', running queued tasks meanwhile.
+static inline void wp_sync(wp_group *group) {
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+        if (!wp_run_one(wp_current, wp_self)) sched_yield();
+    }
+}
+
+static inline void wp_destroy(wp_pool *pool) {
+    pthread_mutex_lock(&pool->idle_lock);
+    __atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+    for (unsigned i = 1; i <= pool->started; i++) pthread_join(pool->threads[i], NULL);
+    for (unsigned i = 0; i < pool->nworkers; i++) pthread_mutex_destroy(&pool->deques[i].lock);
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->idle_cond);
+    free(pool->deques);
+    free(pool->threads);
+}
+
+// Start nworkers - 1 threads; the caller of wp_run is worker 0. Returns 0, or
+// -1 if memory or a thread could not be had; the threads already started are
+// then stopped and joined, and the pool needs no wp_destroy.
+static inline int wp_init(wp_pool *pool, unsigned nworkers) {
+    if (nworkers == 0) nworkers = 1;
+    pool->nworkers = nworkers;
+    pool->started = 0;
+    pool->queued = 0;
+    pool->sleepers = 0;
+    pool->stop = 0;
+    pool->deques = calloc(nworkers, sizeof(wp_deque));
+    pool->threads = calloc(nworkers, sizeof(pthread_t));
+    if (pool->deques == NULL || pool->threads == NULL) {
+        free(pool->deques);
+        free(pool->threads);
+        return -1;
+    }
+    for (unsigned i = 0; i < nworkers; i++) pthread_mutex_init(&pool->deques[i].lock, NULL);
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+    for (unsigned i = 1; i < nworkers; i++) {
+        wp_worker_arg *w = malloc(sizeof(*w));
+        if (w == NULL) break;
+        w->pool = pool;
+        w->self = i;
+        if (pthread_create(&pool->threads[i], NULL, wp_worker_main, w) != 0) {
+            free(w);
+            break;
+        }
+        pool->started = i;
+    }
+    if (pool->started != nworkers - 1) {
+        wp_destroy(pool);
+        return -1;
+    }
+    return 0;
+}
+
+// Run fn(arg) on the calling thread as worker 0 of 'pool' and return when it
+// (and everything it synced on) has finished.
+static inline void wp_run(wp_pool *pool, wp_fn fn, void *arg) {
+    wp_pool *saved = wp_current;
+    unsigned saved_self = wp_self;
+    wp_current = pool;
+    wp_self = 0;
+    fn(arg);
+    wp_current = saved;
+    wp_self = saved_self;
+}
+
+#endif // WORKPOOL_H